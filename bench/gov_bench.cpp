@@ -0,0 +1,172 @@
+// Microbenchmarks for the front end and the tree-walking interpreter.
+// Every case reports throughput and heap allocations per iteration; inputs
+// are generated at several sizes so costs that grow faster than the input
+// stand out.
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "typechecker.h"
+#include "interpreter.h"
+#include "stats.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Allocations made while `body` runs, averaged over the benchmark's
+// iterations
+template <typename Body>
+void countAllocations(benchmark::State& state, const Body& body) {
+    setAllocationCounting(true);
+    uint64_t before = allocationCounts().allocations;
+    for (auto _ : state) {
+        body();
+    }
+    uint64_t allocations = allocationCounts().allocations - before;
+    state.counters["allocs/iter"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// Declarations, assignments, conditionals and output, repeated up to about
+// `size` bytes
+std::string keywordDenseSource(size_t size) {
+    std::string source = "!I_LOVE_GOVERNMENT\n";
+    for (int i = 0; source.size() < size; i++) {
+        std::string name = "V" + std::to_string(i);
+        source += "PLEASE DECLARE_VARIABLE \"" + name + "\" AS INTEGER\n";
+        source += "PLEASE SET " + name + " TO " + name + " + 1\n";
+        source += "IF " + name + " LESS_THAN 3 THEN\n";
+        source += "    PRAISE_LEADER \"small \" + " + name + "\n";
+        source += "ELSE\n";
+        source += "    PLEASE INCREMENT " + name + " BY 2\n";
+        source += "END_IF\n";
+    }
+    return source;
+}
+
+// X with `depth` alternating + 1 and - 1 wrapped around it, so the value
+// stays put however often it is evaluated
+std::string nestedExpression(int depth) {
+    std::string expression = "X";
+    for (int i = 0; i < depth; i++) {
+        expression = "(" + expression + (i % 2 ? " - 1)" : " + 1)");
+    }
+    return expression;
+}
+
+std::string deepExpressionSource(int depth, int statements) {
+    std::string source = "!I_LOVE_GOVERNMENT\nPLEASE DECLARE_VARIABLE \"X\" AS INTEGER\n";
+    std::string line = "PLEASE SET X TO " + nestedExpression(depth) + "\n";
+    for (int i = 0; i < statements; i++) {
+        source += line;
+    }
+    return source;
+}
+
+std::string loopSource(int64_t iterations, const std::string& declarations, const std::string& body) {
+    return "!I_LOVE_GOVERNMENT\nPLEASE DECLARE_VARIABLE \"I\" AS INTEGER\n" + declarations +
+           "WHILE I LESS_THAN " + std::to_string(iterations) + " DO\n" + body +
+           "    PLEASE INCREMENT I BY 1\nEND_WHILE\n";
+}
+
+// A resolved and type checked program, ready for the interpreter
+std::unique_ptr<Program> checkedProgram(const std::string& source) {
+    Lexer lexer(source);
+    Parser parser(lexer);
+    std::unique_ptr<Program> program = parser.parse();
+    Resolver resolver;
+    TypeChecker typeChecker;
+    if (!program || !resolver.resolve(program.get()) || !typeChecker.check(program.get())) {
+        std::cerr << "Benchmark program does not compile:\n" << source << std::endl;
+        std::abort();
+    }
+    return program;
+}
+
+void interpret(benchmark::State& state, const std::string& source, int64_t items) {
+    std::unique_ptr<Program> program = checkedProgram(source);
+    countAllocations(state, [&]() {
+        Interpreter<NoHooks> interpreter;
+        interpreter.interpret(program.get());
+    });
+    state.SetItemsProcessed(state.iterations() * items);
+}
+
+void BM_LexerTokenize(benchmark::State& state) {
+    std::string source = keywordDenseSource(static_cast<size_t>(state.range(0)));
+    countAllocations(state, [&]() {
+        benchmark::DoNotOptimize(Lexer(source).tokenize());
+    });
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+BENCHMARK(BM_LexerTokenize)->Arg(4 << 10)->Arg(256 << 10)->Arg(4 << 20);
+
+void BM_ParserKeywordDense(benchmark::State& state) {
+    std::string source = keywordDenseSource(static_cast<size_t>(state.range(0)));
+    countAllocations(state, [&]() {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        benchmark::DoNotOptimize(parser.parse());
+    });
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+BENCHMARK(BM_ParserKeywordDense)->Arg(4 << 10)->Arg(256 << 10)->Arg(4 << 20);
+
+// range(0): nesting depth
+void BM_ParserDeepExpression(benchmark::State& state) {
+    std::string source = deepExpressionSource(static_cast<int>(state.range(0)), 100);
+    countAllocations(state, [&]() {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        benchmark::DoNotOptimize(parser.parse());
+    });
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+BENCHMARK(BM_ParserDeepExpression)->Arg(8)->Arg(64)->Arg(512);
+
+// Items are evaluated operators
+void BM_InterpreterDeepExpression(benchmark::State& state) {
+    int depth = static_cast<int>(state.range(0));
+    int64_t iterations = 100000 / depth;
+    std::string body = "    PLEASE SET X TO " + nestedExpression(depth) + "\n";
+    interpret(state, loopSource(iterations, "PLEASE DECLARE_VARIABLE \"X\" AS INTEGER\n", body), iterations * depth);
+}
+BENCHMARK(BM_InterpreterDeepExpression)->Arg(8)->Arg(64)->Arg(512);
+
+// Items are loop iterations, each doing four arithmetic operations
+void BM_InterpreterIntegerLoop(benchmark::State& state) {
+    std::string declarations = "PLEASE DECLARE_VARIABLE \"Sum\" AS INTEGER\n";
+    std::string body = "    PLEASE SET Sum TO Sum + I * 2 - I / 3\n";
+    interpret(state, loopSource(state.range(0), declarations, body), state.range(0));
+}
+BENCHMARK(BM_InterpreterIntegerLoop)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+// Items are appends; the string is restarted every 64 of them so its
+// length, and the cost of copying it, stays bounded
+void BM_InterpreterStringConcat(benchmark::State& state) {
+    std::string declarations = "PLEASE DECLARE_VARIABLE \"S\" AS STRING\n"
+                               "PLEASE DECLARE_VARIABLE \"J\" AS INTEGER\n";
+    std::string body = "    PLEASE SET S TO \"\"\n"
+                       "    PLEASE SET J TO 0\n"
+                       "    WHILE J LESS_THAN 64 DO\n"
+                       "        PLEASE SET S TO S + \"ab\" + J\n"
+                       "        PLEASE INCREMENT J BY 1\n"
+                       "    END_WHILE\n";
+    interpret(state, loopSource(state.range(0) / 64, declarations, body), state.range(0) / 64 * 64);
+}
+BENCHMARK(BM_InterpreterStringConcat)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+// Items are element copies between two positions of a 1024-element array
+void BM_InterpreterArrayIndex(benchmark::State& state) {
+    std::string declarations = "PLEASE DECLARE_VARIABLE \"A\" AS ARRAY_OF_STRING SIZE 1024\n"
+                               "PLEASE DECLARE_VARIABLE \"K\" AS INTEGER\n";
+    std::string body = "    PLEASE SET K TO I - I / 1024 * 1024\n"
+                       "    PLEASE SET A[K] TO A[1023 - K]\n";
+    interpret(state, loopSource(state.range(0), declarations, body), state.range(0));
+}
+BENCHMARK(BM_InterpreterArrayIndex)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+} // namespace
+
+BENCHMARK_MAIN();
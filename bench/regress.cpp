@@ -0,0 +1,506 @@
+// Runs gov on the benchmark corpus and compares the results with a stored
+// baseline. Each workload runs several times; the fastest wall time, the
+// peak resident set size and, where the kernel allows it, the number of
+// instructions retired are recorded. Exits with 1 when any of them is
+// worse than the baseline by more than the threshold.
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef GOV_BENCH_DIR
+#define GOV_BENCH_DIR "bench"
+#endif
+#ifndef GOV_BINARY
+#define GOV_BINARY "build/bin/gov"
+#endif
+// CMAKE_BUILD_TYPE of GOV_BINARY
+#ifndef GOV_BUILD_TYPE
+#define GOV_BUILD_TYPE ""
+#endif
+
+namespace {
+
+struct Workload {
+    std::string name;
+    std::string file; // in the bench directory; empty for the generated source
+    std::vector<std::string> args;
+    bool warmCache = false; // run with a cache primed by an untimed run
+};
+
+// Engines that finish in a few milliseconds are left out, since process
+// start-up would dominate their times
+const std::vector<Workload> WORKLOADS = {
+    {"sieve", "sieve.gov", {}},
+    {"sieve-vm", "sieve.gov", {"--engine=vm"}},
+    {"nested-loops", "nested_loops.gov", {}},
+    {"nested-loops-vm", "nested_loops.gov", {"--engine=vm"}},
+    {"integers-closure", "integers.gov", {"--engine=closure"}},
+    {"strings", "strings.gov", {}},
+    {"string-building", "report.gov", {}},
+    {"dispatch", "dispatch.gov", {}},
+    {"dispatch-vm", "dispatch.gov", {"--engine=vm"}},
+    {"printing-closure", "printing.gov", {"--engine=closure"}},
+    {"large-source", "", {}},
+    {"large-source-cached", "", {}, true},
+};
+
+// Size of the generated source, enough for the parallel front end
+constexpr size_t GENERATED_SIZE = 8 * 1024 * 1024;
+// Wall time changes smaller than this are noise, whatever the percentage
+constexpr double MIN_WALL_CHANGE_MS = 10.0;
+
+struct Options {
+    std::string gov = GOV_BINARY;
+    std::string benchDir = GOV_BENCH_DIR;
+    std::string baseline;
+    std::string output;
+    int runs = 5;
+    double threshold = 15.0; // percent
+};
+
+struct Result {
+    double wallMs = 0;
+    double medianWallMs = 0;
+    long maxRssKb = 0;
+    long long instructions = -1; // -1: not available
+};
+
+void printHelp(const char* programName) {
+    std::cout << "Usage: " << programName << " [OPTIONS]\n\n";
+    std::cout << "Runs gov on each workload in the benchmark corpus and reports wall time,\n";
+    std::cout << "peak RSS and instructions retired.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --gov=PATH           gov binary to measure (default: " << GOV_BINARY << ")\n";
+    std::cout << "  --bench-dir=DIR      Directory of the .gov workloads (default: " << GOV_BENCH_DIR << ")\n";
+    std::cout << "  --runs=N             Runs per workload (default: 5)\n";
+    std::cout << "  --baseline=FILE      Compare with this results file and fail on regressions\n";
+    std::cout << "  --threshold=PERCENT  Allowed slowdown or growth over the baseline (default: 15)\n";
+    std::cout << "  --output=FILE        Write the results as JSON, e.g. to update the baseline\n";
+}
+
+Options parseArgs(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            size_t length = std::strlen(prefix);
+            return arg.compare(0, length, prefix) == 0 ? argv[i] + length : nullptr;
+        };
+        if (arg == "-h" || arg == "--help") {
+            printHelp(argv[0]);
+            exit(0);
+        } else if (const char* gov = value("--gov=")) {
+            options.gov = gov;
+        } else if (const char* dir = value("--bench-dir=")) {
+            options.benchDir = dir;
+        } else if (const char* baseline = value("--baseline=")) {
+            options.baseline = baseline;
+        } else if (const char* output = value("--output=")) {
+            options.output = output;
+        } else if (const char* runs = value("--runs=")) {
+            options.runs = std::atoi(runs);
+            if (options.runs < 1) {
+                std::cerr << "Error: --runs requires a positive number\n";
+                exit(1);
+            }
+        } else if (const char* threshold = value("--threshold=")) {
+            options.threshold = std::atof(threshold);
+            if (options.threshold <= 0) {
+                std::cerr << "Error: --threshold requires a positive percentage\n";
+                exit(1);
+            }
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            exit(1);
+        }
+    }
+    return options;
+}
+
+// Top-level statements of every kind, most of them cheap to run, so the
+// time goes into the front end
+std::string generatedSource(size_t size) {
+    std::string source = "!I_LOVE_GOVERNMENT\n"
+                         "OBEY_PARTY_LINE \"Generated: a large source that does little work\"\n"
+                         "PLEASE DECLARE_VARIABLE \"A\" AS INTEGER\n"
+                         "PLEASE DECLARE_VARIABLE \"B\" AS INTEGER\n"
+                         "PLEASE DECLARE_VARIABLE \"S\" AS STRING\n"
+                         "PLEASE DECLARE_VARIABLE \"Names\" AS ARRAY_OF_STRING SIZE 16\n";
+    for (int i = 0; source.size() < size; i++) {
+        std::string n = std::to_string(i % 97);
+        source += "PLEASE SET A TO A + " + n + " * B - 3\n";
+        source += "IF A LESS_THAN 1000 THEN\n";
+        source += "    PLEASE SET S TO \"comrade \" + A\n";
+        source += "ELSE_IF A EQUALS " + n + " THEN\n";
+        source += "    PLEASE INCREMENT B BY 1\n";
+        source += "ELSE\n";
+        source += "    PLEASE SET A TO 0\n";
+        source += "END_IF\n";
+        source += "PLEASE SET Names[" + std::to_string(i % 16) + "] TO S + \" of block " + std::to_string(i) + "\"\n";
+        source += "PLEASE SET B TO 0\n";
+        source += "WHILE B LESS_THAN 3 DO\n";
+        source += "    PLEASE INCREMENT B BY 1\n";
+        source += "END_WHILE\n";
+    }
+    source += "PRAISE_LEADER A\nPRAISE_LEADER Names[7]\n";
+    return source;
+}
+
+#ifdef __linux__
+// A counter of user-space instructions that starts when `pid` calls exec,
+// or -1 when the kernel or the machine offers none
+int openInstructionCounter(pid_t pid) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+// Runs `argv` once with standard input and output on /dev/null. Returns
+// false, after reporting it, when the process cannot start or fails.
+bool runOnce(const std::vector<std::string>& argv, const std::string& cacheDir, Result& result) {
+    // The child waits on this pipe until its instruction counter is set up
+    int ready[2];
+    if (pipe(ready) != 0) {
+        std::cerr << "Error: pipe failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // Buffered output would otherwise be written again by the child
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error: fork failed: " << std::strerror(errno) << "\n";
+        close(ready[0]);
+        close(ready[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(ready[1]);
+        char byte;
+        if (read(ready[0], &byte, 1) != 1) {
+            _exit(127);
+        }
+        close(ready[0]);
+        FILE* null = std::freopen("/dev/null", "r", stdin);
+        null = null ? std::freopen("/dev/null", "w", stdout) : nullptr;
+        setenv("XDG_CACHE_HOME", cacheDir.c_str(), 1);
+        std::vector<char*> args;
+        for (const auto& arg : argv) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        if (null) {
+            execv(args[0], args.data());
+        }
+        _exit(127);
+    }
+
+    close(ready[0]);
+    int counter = -1;
+#ifdef __linux__
+    counter = openInstructionCounter(pid);
+#endif
+    auto start = std::chrono::steady_clock::now();
+    ssize_t written = write(ready[1], "x", 1);
+    close(ready[1]);
+    int status = 0;
+    rusage usage;
+    pid_t waited = wait4(pid, &status, 0, &usage);
+    auto end = std::chrono::steady_clock::now();
+
+    result.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+    result.maxRssKb = waited == pid ? usage.ru_maxrss : 0; // kilobytes on Linux
+    result.instructions = -1;
+    if (counter >= 0) {
+        long long count = 0;
+        if (read(counter, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+            result.instructions = count;
+        }
+        close(counter);
+    }
+    if (written != 1 || waited != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Error: " << argv[0] << " failed on " << argv.back() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool measure(const Workload& workload, const std::string& file, const Options& options, const std::string& cacheDir,
+             Result& result) {
+    std::vector<std::string> argv = {options.gov, "run"};
+    argv.insert(argv.end(), workload.args.begin(), workload.args.end());
+    if (!workload.warmCache) {
+        argv.push_back("--no-cache");
+    }
+    argv.push_back(file);
+
+    Result run;
+    if (workload.warmCache && !runOnce(argv, cacheDir, run)) {
+        return false;
+    }
+    std::vector<double> times;
+    result = Result();
+    for (int i = 0; i < options.runs; i++) {
+        if (!runOnce(argv, cacheDir, run)) {
+            return false;
+        }
+        times.push_back(run.wallMs);
+        result.maxRssKb = std::max(result.maxRssKb, run.maxRssKb);
+        if (run.instructions >= 0 && (result.instructions < 0 || run.instructions < result.instructions)) {
+            result.instructions = run.instructions;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    result.wallMs = times.front();
+    result.medianWallMs = times[times.size() / 2];
+    return true;
+}
+
+std::string toJson(const std::vector<std::pair<std::string, Result>>& results, int runs) {
+    std::ostringstream out;
+    out << "{\n  \"runs\": " << runs << ",\n  \"workloads\": {";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i].second;
+        char wall[64];
+        std::snprintf(wall, sizeof(wall), "\"wall_ms\": %.1f, \"median_wall_ms\": %.1f", result.wallMs,
+                      result.medianWallMs);
+        out << (i ? ",\n" : "\n") << "    \"" << results[i].first << "\": {" << wall
+            << ", \"max_rss_kb\": " << result.maxRssKb << ", \"instructions\": ";
+        if (result.instructions >= 0) {
+            out << result.instructions;
+        } else {
+            out << "null";
+        }
+        out << "}";
+    }
+    out << "\n  }\n}\n";
+    return out.str();
+}
+
+// Reads the numbers out of a results file written by toJson. Null and
+// missing values are left out.
+class BaselineReader {
+private:
+    const std::string& text;
+    size_t pos = 0;
+    bool failed = false;
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string() {
+        std::string value;
+        if (!consume('"')) {
+            failed = true;
+            return value;
+        }
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && pos + 1 < text.size()) pos++;
+            value += text[pos++];
+        }
+        if (!consume('"')) failed = true;
+        return value;
+    }
+
+    // Calls member(key) for each member of an object
+    template <typename Member>
+    void object(const Member& member) {
+        if (!consume('{')) {
+            failed = true;
+            return;
+        }
+        if (consume('}')) return;
+        do {
+            std::string key = string();
+            if (failed || !consume(':')) {
+                failed = true;
+                return;
+            }
+            member(key);
+        } while (!failed && consume(','));
+        if (!consume('}')) failed = true;
+    }
+
+    // A number, or a null that leaves `value` alone
+    void number(double& value) {
+        skipSpace();
+        if (text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            return;
+        }
+        const char* begin = text.c_str() + pos;
+        char* end = nullptr;
+        value = std::strtod(begin, &end);
+        if (end == begin) failed = true;
+        pos += static_cast<size_t>(end - begin);
+    }
+
+public:
+    explicit BaselineReader(const std::string& text) : text(text) {}
+
+    bool read(std::map<std::string, Result>& results) {
+        object([&](const std::string& key) {
+            if (key != "workloads") {
+                double ignored = 0;
+                number(ignored);
+                return;
+            }
+            object([&](const std::string& name) {
+                Result& result = results[name];
+                double rss = 0;
+                double instructions = -1;
+                object([&](const std::string& field) {
+                    if (field == "wall_ms") {
+                        number(result.wallMs);
+                    } else if (field == "median_wall_ms") {
+                        number(result.medianWallMs);
+                    } else if (field == "max_rss_kb") {
+                        number(rss);
+                    } else if (field == "instructions") {
+                        number(instructions);
+                    } else {
+                        failed = true;
+                    }
+                });
+                result.maxRssKb = static_cast<long>(rss);
+                result.instructions = static_cast<long long>(instructions);
+            });
+        });
+        return !failed;
+    }
+};
+
+// Percentage change from `before` to `after`
+double change(double before, double after) {
+    return before > 0 ? (after - before) * 100.0 / before : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options = parseArgs(argc, argv);
+    namespace fs = std::filesystem;
+
+    // Baselines are absolute times, so an unoptimized gov would either
+    // fail every comparison or record numbers nothing else can match
+    bool keepsBaseline = !options.baseline.empty() || !options.output.empty();
+    if (keepsBaseline && options.gov == GOV_BINARY && std::strcmp(GOV_BUILD_TYPE, "Release") != 0) {
+        std::cerr << "Error: " << GOV_BINARY << " is not a Release build (CMAKE_BUILD_TYPE is \""
+                  << GOV_BUILD_TYPE << "\"); configure with -DCMAKE_BUILD_TYPE=Release to compare or record a baseline\n";
+        return 1;
+    }
+
+    std::map<std::string, Result> baseline;
+    if (!options.baseline.empty()) {
+        std::ifstream file(options.baseline, std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+        if (!file || !BaselineReader(text.str()).read(baseline)) {
+            std::cerr << "Error: Could not read baseline " << options.baseline << "\n";
+            return 1;
+        }
+    }
+
+    // A private directory for the generated source and the program cache,
+    // so neither the user's cache nor an earlier run affects the results
+    std::error_code error;
+    std::string workTemplate = (fs::temp_directory_path(error) / "gov-regress-XXXXXX").string();
+    if (error || !mkdtemp(workTemplate.data())) {
+        std::cerr << "Error: Could not create a directory in " << fs::temp_directory_path(error).string() << "\n";
+        return 1;
+    }
+    fs::path workDir = workTemplate;
+    std::string generated = (workDir / "large.gov").string();
+    std::ofstream(generated, std::ios::binary) << generatedSource(GENERATED_SIZE);
+    if (!fs::exists(generated)) {
+        std::cerr << "Error: Could not write " << generated << "\n";
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, Result>> results;
+    bool ok = true;
+    bool regressed = false;
+    std::printf("%-20s %10s %10s %12s %16s\n", "workload", "wall ms", "median ms", "max RSS KB", "instructions");
+    for (const Workload& workload : WORKLOADS) {
+        std::string file = workload.file.empty() ? generated : options.benchDir + "/" + workload.file;
+        Result result;
+        if (!measure(workload, file, options, (workDir / "cache").string(), result)) {
+            ok = false;
+            continue;
+        }
+        results.emplace_back(workload.name, result);
+        std::printf("%-20s %10.1f %10.1f %12ld %16s\n", workload.name.c_str(), result.wallMs, result.medianWallMs,
+                    result.maxRssKb, result.instructions >= 0 ? std::to_string(result.instructions).c_str() : "-");
+
+        auto known = baseline.find(workload.name);
+        if (known == baseline.end()) {
+            continue;
+        }
+        const Result& before = known->second;
+        auto check = [&](const char* metric, double was, double now, double slack) {
+            double percent = change(was, now);
+            if (was > 0 && percent > options.threshold && now - was > slack) {
+                std::printf("  REGRESSION: %s %+.1f%% (baseline %.0f, now %.0f)\n", metric, percent, was, now);
+                regressed = true;
+            }
+        };
+        check("wall time", before.wallMs, result.wallMs, MIN_WALL_CHANGE_MS);
+        check("max RSS", static_cast<double>(before.maxRssKb), static_cast<double>(result.maxRssKb), 0);
+        if (before.instructions >= 0 && result.instructions >= 0) {
+            check("instructions", static_cast<double>(before.instructions), static_cast<double>(result.instructions),
+                  0);
+        }
+    }
+    fs::remove_all(workDir, error);
+
+    if (!options.output.empty()) {
+        std::ofstream file(options.output, std::ios::binary);
+        file << toJson(results, options.runs);
+        if (!file) {
+            std::cerr << "Error: Could not write " << options.output << "\n";
+            return 1;
+        }
+    }
+    if (!options.baseline.empty()) {
+        std::printf(regressed ? "Regressed past %.0f%% of %s\n" : "No regressions past %.0f%% of %s\n",
+                    options.threshold, options.baseline.c_str());
+    }
+    return ok && !regressed ? 0 : 1;
+}
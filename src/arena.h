@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Nodes live in an Arena and are reclaimed all at once when it goes away,
+// so dropping a single node pointer frees nothing and runs no destructor
+struct ArenaDeleter {
+    template <typename T>
+    void operator()(T*) const {}
+};
+
+template <typename T>
+using NodePtr = std::unique_ptr<T, ArenaDeleter>;
+
+// Child lists allocate from the same arena as the nodes they hold
+template <typename T>
+using NodeList = std::pmr::vector<NodePtr<T>>;
+
+// Bump allocator for the AST. Nodes, their child lists and their names are
+// carved out of large blocks in allocation order, so a tree is laid out
+// roughly in the order the engines walk it, and destroying the arena
+// releases the whole tree without visiting a single node. Everything
+// allocated here must therefore keep all of its memory in the arena.
+class Arena {
+private:
+    std::pmr::monotonic_buffer_resource memory;
+
+public:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+    Arena() : memory(INITIAL_BLOCK_SIZE) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &memory; }
+
+    template <typename T, typename... Args>
+    NodePtr<T> make(Args&&... args) {
+        void* place = memory.allocate(sizeof(T), alignof(T));
+        return NodePtr<T>(new (place) T(std::forward<Args>(args)...));
+    }
+
+    // Copies `text` into the arena; the view stays valid as long as it does
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) {
+            return std::string_view();
+        }
+        auto chars = static_cast<char*>(memory.allocate(text.size(), 1));
+        std::memcpy(chars, text.data(), text.size());
+        return std::string_view(chars, text.size());
+    }
+};
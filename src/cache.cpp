@@ -0,0 +1,603 @@
+#include "cache.h"
+#include "source.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#ifndef GOV_VERSION
+#define GOV_VERSION "unknown"
+#endif
+
+// Hash of the sources the interpreter was built from, set by CMake
+#ifndef GOV_BUILD_ID
+#define GOV_BUILD_ID ""
+#endif
+
+namespace {
+
+// Bump whenever the layout below or the meaning of a cached tree changes,
+// e.g. when the resolver, type checker or optimizer starts writing
+// something new into the AST
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr char MAGIC[4] = {'G', 'O', 'V', 'C'};
+
+// Files past this total are evicted, least recently used first. A .govc
+// is about twice the size of its source, so this holds a few hundred
+// ordinary programs or several of the largest ones.
+constexpr uint64_t CACHE_SIZE_LIMIT = 512ULL << 20;
+
+enum class NodeTag : uint8_t {
+    NONE,
+    STRING_LITERAL,
+    INTEGER_LITERAL,
+    IDENTIFIER,
+    ARRAY_ACCESS,
+    BINARY_OP,
+    PRINT,
+    VAR_DECLARATION,
+    ASSIGNMENT,
+    FOR_LOOP,
+    WHILE_LOOP,
+    IF,
+    INCREMENT,
+    READ
+};
+
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint64_t versionHash;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t optimizationLevel;
+    uint32_t reserved;
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+uint64_t versionHash() {
+    static const uint64_t hash = hashBytes(GOV_VERSION GOV_BUILD_ID, FORMAT_VERSION);
+    return hash;
+}
+
+uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Appends the tree in preorder. Values are stored in host byte order; a
+// cache is never shared between machines.
+class Writer {
+private:
+    std::string& out;
+
+    void node(NodeTag tag, const ASTNode* at) {
+        u8(static_cast<uint8_t>(tag));
+        i32(at->line);
+        i32(at->column);
+    }
+
+public:
+    explicit Writer(std::string& out) : out(out) {}
+
+    void u8(uint8_t value) { out.push_back(static_cast<char>(value)); }
+    void i32(int32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void u32(uint32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void text(std::string_view value) {
+        u32(static_cast<uint32_t>(value.size()));
+        out.append(value.data(), value.size());
+    }
+
+    void expression(const Expression* expr) {
+        if (auto literal = dynamic_cast<const StringLiteral*>(expr)) {
+            node(NodeTag::STRING_LITERAL, expr);
+            text(literal->value);
+        } else if (auto literal = dynamic_cast<const IntegerLiteral*>(expr)) {
+            node(NodeTag::INTEGER_LITERAL, expr);
+            i32(literal->value);
+        } else if (auto id = dynamic_cast<const Identifier*>(expr)) {
+            node(NodeTag::IDENTIFIER, expr);
+            text(id->name);
+            i32(id->slot);
+        } else if (auto access = dynamic_cast<const ArrayAccess*>(expr)) {
+            node(NodeTag::ARRAY_ACCESS, expr);
+            expression(access->array.get());
+            expression(access->index.get());
+        } else if (auto binOp = dynamic_cast<const BinaryOp*>(expr)) {
+            node(NodeTag::BINARY_OP, expr);
+            u8(static_cast<uint8_t>(binOp->op));
+            u8(static_cast<uint8_t>(binOp->operands));
+            expression(binOp->left.get());
+            expression(binOp->right.get());
+        } else {
+            u8(static_cast<uint8_t>(NodeTag::NONE));
+        }
+    }
+
+    void block(const NodeList<Statement>& statements) {
+        u32(static_cast<uint32_t>(statements.size()));
+        for (const auto& stmt : statements) {
+            statement(stmt.get());
+        }
+    }
+
+    void statement(const Statement* stmt) {
+        if (auto print = dynamic_cast<const PrintStatement*>(stmt)) {
+            node(NodeTag::PRINT, stmt);
+            expression(print->expr.get());
+        } else if (auto decl = dynamic_cast<const VarDeclaration*>(stmt)) {
+            node(NodeTag::VAR_DECLARATION, stmt);
+            text(decl->name);
+            text(decl->type);
+            i32(decl->arraySize);
+            i32(decl->slot);
+        } else if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+            node(NodeTag::ASSIGNMENT, stmt);
+            text(assign->varName);
+            i32(assign->slot);
+            expression(assign->index.get());
+            expression(assign->value.get());
+            // The operands are always the right-hand sides along the PLUS
+            // spine of the value, so their count is enough to find them
+            u32(static_cast<uint32_t>(assign->appendOperands.size()));
+        } else if (auto forLoop = dynamic_cast<const ForLoop*>(stmt)) {
+            node(NodeTag::FOR_LOOP, stmt);
+            text(forLoop->varName);
+            expression(forLoop->condition.get());
+            block(forLoop->body);
+        } else if (auto whileLoop = dynamic_cast<const WhileLoop*>(stmt)) {
+            node(NodeTag::WHILE_LOOP, stmt);
+            expression(whileLoop->condition.get());
+            block(whileLoop->body);
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt)) {
+            node(NodeTag::IF, stmt);
+            expression(ifStmt->condition.get());
+            block(ifStmt->thenBranch);
+            u32(static_cast<uint32_t>(ifStmt->elseIfClauses.size()));
+            for (const auto& clause : ifStmt->elseIfClauses) {
+                expression(clause.condition.get());
+                block(clause.body);
+            }
+            block(ifStmt->elseBranch);
+        } else if (auto inc = dynamic_cast<const IncrementStatement*>(stmt)) {
+            node(NodeTag::INCREMENT, stmt);
+            text(inc->varName);
+            i32(inc->slot);
+            i32(inc->amount);
+        } else if (auto read = dynamic_cast<const ReadStatement*>(stmt)) {
+            node(NodeTag::READ, stmt);
+            text(read->varName);
+            i32(read->slot);
+        } else {
+            u8(static_cast<uint8_t>(NodeTag::NONE));
+        }
+    }
+};
+
+// Rebuilds a tree written by Writer in the program's arena. Every read is
+// bounds checked; after the first bad one `failed` is set and the rest
+// return placeholders until the caller gives up on the whole file.
+class Reader {
+private:
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+    Arena* arena;
+
+    template <typename T>
+    T scalar() {
+        T value{};
+        if (size - pos < sizeof(T)) {
+            failed = true;
+            return value;
+        }
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    NodePtr<T> located(NodePtr<T> node, int line, int column) {
+        node->line = line;
+        node->column = column;
+        return node;
+    }
+
+public:
+    bool failed = false;
+    size_t slotCount = 0; // read before the tree, which indexes it
+
+    Reader(const char* data, size_t size, Arena* arena) : data(data), size(size), arena(arena) {}
+
+    // A count of items that each take at least one more byte
+    uint32_t count() {
+        uint32_t value = u32();
+        if (value > size - pos) {
+            failed = true;
+            return 0;
+        }
+        return value;
+    }
+
+    uint8_t u8() { return scalar<uint8_t>(); }
+    int32_t i32() { return scalar<int32_t>(); }
+    uint32_t u32() { return scalar<uint32_t>(); }
+    bool atEnd() const { return pos == size; }
+
+    // The payload hash is not a proof against damage, and the engines index
+    // variables by slot without checking, so every slot must exist
+    int slot() {
+        int value = i32();
+        if (value < 0 || static_cast<size_t>(value) >= slotCount) {
+            failed = true;
+        }
+        return value;
+    }
+
+    // Only the operators the parser builds BinaryOp nodes from
+    TokenType binaryOperator() {
+        auto op = static_cast<TokenType>(u8());
+        switch (op) {
+            case TokenType::OR:
+            case TokenType::AND:
+            case TokenType::EQUALS:
+            case TokenType::NOT_EQUALS:
+            case TokenType::LESS_THAN:
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+            case TokenType::MULTIPLY:
+            case TokenType::DIVIDE:
+                return op;
+            default:
+                failed = true;
+                return TokenType::PLUS;
+        }
+    }
+
+    OperandTypes operandTypes() {
+        uint8_t value = u8();
+        if (value > static_cast<uint8_t>(OperandTypes::MIXED)) {
+            failed = true;
+            return OperandTypes::GENERIC;
+        }
+        return static_cast<OperandTypes>(value);
+    }
+
+    std::string_view text() {
+        uint32_t length = u32();
+        if (failed || length > size - pos) {
+            failed = true;
+            return std::string_view();
+        }
+        std::string_view value = arena->copy(std::string_view(data + pos, length));
+        pos += length;
+        return value;
+    }
+
+    NodePtr<Expression> expression() {
+        auto tag = static_cast<NodeTag>(u8());
+        if (failed || tag == NodeTag::NONE) {
+            return nullptr;
+        }
+        int line = i32();
+        int column = i32();
+        switch (tag) {
+            case NodeTag::STRING_LITERAL:
+                return located(arena->make<StringLiteral>(text()), line, column);
+            case NodeTag::INTEGER_LITERAL:
+                return located(arena->make<IntegerLiteral>(i32()), line, column);
+            case NodeTag::IDENTIFIER: {
+                auto id = arena->make<Identifier>(text());
+                id->slot = slot();
+                return located(std::move(id), line, column);
+            }
+            case NodeTag::ARRAY_ACCESS: {
+                auto array = expression();
+                auto index = expression();
+                return located(arena->make<ArrayAccess>(std::move(array), std::move(index)), line, column);
+            }
+            case NodeTag::BINARY_OP: {
+                TokenType op = binaryOperator();
+                OperandTypes operands = operandTypes();
+                auto left = expression();
+                auto right = expression();
+                auto binOp = arena->make<BinaryOp>(std::move(left), op, std::move(right));
+                binOp->operands = operands;
+                return located(std::move(binOp), line, column);
+            }
+            default:
+                failed = true;
+                return nullptr;
+        }
+    }
+
+    void block(NodeList<Statement>& statements) {
+        uint32_t length = count();
+        statements.reserve(length);
+        for (uint32_t i = 0; i < length && !failed; i++) {
+            statements.push_back(statement());
+        }
+    }
+
+    NodePtr<Statement> statement() {
+        auto tag = static_cast<NodeTag>(u8());
+        if (failed || tag == NodeTag::NONE) {
+            return nullptr;
+        }
+        int line = i32();
+        int column = i32();
+        switch (tag) {
+            case NodeTag::PRINT:
+                return located(arena->make<PrintStatement>(expression()), line, column);
+            case NodeTag::VAR_DECLARATION: {
+                std::string_view name = text();
+                std::string_view type = text();
+                int arraySize = i32();
+                auto decl = arena->make<VarDeclaration>(name, type, arraySize);
+                decl->slot = slot();
+                return located(std::move(decl), line, column);
+            }
+            case NodeTag::ASSIGNMENT: {
+                std::string_view name = text();
+                int slot = this->slot();
+                auto index = expression();
+                auto value = expression();
+                auto assign = arena->make<Assignment>(name, std::move(value), std::move(index), arena->resource());
+                assign->slot = slot;
+                uint32_t operands = count();
+                Expression* spine = assign->value.get();
+                assign->appendOperands.resize(operands);
+                for (uint32_t i = operands; i-- > 0 && !failed;) {
+                    auto binOp = dynamic_cast<BinaryOp*>(spine);
+                    if (!binOp) {
+                        failed = true;
+                        break;
+                    }
+                    assign->appendOperands[i] = binOp->right.get();
+                    spine = binOp->left.get();
+                }
+                return located(std::move(assign), line, column);
+            }
+            case NodeTag::FOR_LOOP: {
+                std::string_view name = text();
+                auto loop = arena->make<ForLoop>(name, expression(), arena->resource());
+                block(loop->body);
+                return located(std::move(loop), line, column);
+            }
+            case NodeTag::WHILE_LOOP: {
+                auto loop = arena->make<WhileLoop>(expression(), arena->resource());
+                block(loop->body);
+                return located(std::move(loop), line, column);
+            }
+            case NodeTag::IF: {
+                auto ifStmt = arena->make<IfStatement>(expression(), arena->resource());
+                block(ifStmt->thenBranch);
+                uint32_t clauses = count();
+                for (uint32_t i = 0; i < clauses && !failed; i++) {
+                    ElseIfClause clause(expression(), arena->resource());
+                    block(clause.body);
+                    ifStmt->elseIfClauses.push_back(std::move(clause));
+                }
+                block(ifStmt->elseBranch);
+                return located(std::move(ifStmt), line, column);
+            }
+            case NodeTag::INCREMENT: {
+                std::string_view name = text();
+                int slot = this->slot();
+                auto inc = arena->make<IncrementStatement>(name, i32());
+                inc->slot = slot;
+                return located(std::move(inc), line, column);
+            }
+            case NodeTag::READ: {
+                auto read = arena->make<ReadStatement>(text());
+                read->slot = slot();
+                return located(std::move(read), line, column);
+            }
+            default:
+                failed = true;
+                return nullptr;
+        }
+    }
+};
+
+// Removes the least recently used files until the directory fits in
+// CACHE_SIZE_LIMIT. load() refreshes the write time of a hit, so the write
+// time is the last use. Leftover temporary files count and go first.
+void evictOldFiles(const std::filesystem::path& directory) {
+    namespace fs = std::filesystem;
+    struct Entry {
+        fs::file_time_type used;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().filename().string().find(".govc") == std::string::npos) {
+            continue;
+        }
+        std::error_code entryError;
+        uint64_t size = it->file_size(entryError);
+        fs::file_time_type used = it->last_write_time(entryError);
+        if (!entryError && it->is_regular_file(entryError)) {
+            entries.push_back({used, size, it->path()});
+            total += size;
+        }
+    }
+    if (total <= CACHE_SIZE_LIMIT) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= CACHE_SIZE_LIMIT) {
+            break;
+        }
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+}
+
+std::string cacheDirectory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return std::string(xdg) + "/gov";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::string(home) + "/.cache/gov";
+    }
+    return std::string();
+}
+
+} // namespace
+
+uint64_t hashBytes(std::string_view data, uint64_t seed) {
+    const uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+    uint64_t hash = seed ^ (data.size() * MULTIPLIER);
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        word *= 0xBF58476D1CE4E5B9ULL;
+        word ^= word >> 31;
+        hash = rotateLeft(hash ^ word, 27) * MULTIPLIER;
+    }
+    uint64_t tail = 0;
+    if (i < data.size()) {
+        std::memcpy(&tail, data.data() + i, data.size() - i);
+    }
+    hash = rotateLeft(hash ^ (tail * 0xBF58476D1CE4E5B9ULL), 27) * MULTIPLIER;
+    // Final avalanche (splitmix64)
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+ProgramCache::ProgramCache(std::string_view source, int optimizationLevel)
+    : sourceHash(hashBytes(source)), sourceSize(source.size()), optimizationLevel(optimizationLevel) {
+    std::string directory = cacheDirectory();
+    if (directory.empty()) {
+        return;
+    }
+    uint64_t key = hashBytes(std::string_view(reinterpret_cast<const char*>(&sourceHash), sizeof(sourceHash)),
+                             versionHash() + static_cast<uint64_t>(optimizationLevel));
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.govc", static_cast<unsigned long long>(key));
+    path = directory + "/" + name;
+}
+
+std::unique_ptr<Program> ProgramCache::load() const {
+    if (path.empty()) {
+        return nullptr;
+    }
+    SourceFile file;
+    if (!file.open(path, false)) {
+        return nullptr;
+    }
+    std::string_view contents = file.text();
+
+    Header header;
+    if (contents.size() < sizeof(header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    std::string_view payload = contents.substr(sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.formatVersion != FORMAT_VERSION ||
+        header.versionHash != versionHash() || header.sourceHash != sourceHash ||
+        header.sourceSize != sourceSize || header.optimizationLevel != static_cast<uint32_t>(optimizationLevel) ||
+        header.payloadSize != payload.size() || header.payloadHash != hashBytes(payload)) {
+        return nullptr;
+    }
+
+    auto program = std::make_unique<Program>(std::make_unique<Arena>());
+    Reader reader(payload.data(), payload.size(), program->arena.get());
+    uint32_t slots = reader.count();
+    for (uint32_t i = 0; i < slots && !reader.failed; i++) {
+        std::string_view name = reader.text();
+        std::string_view type = reader.text();
+        int arraySize = reader.i32();
+        bool integerOnly = reader.u8() != 0;
+        // The JIT and gov compile keep integerOnly slots in registers as
+        // ints, so a declared string or array must never claim it
+        if (arraySize < 0 || (integerOnly && (type == "STRING" || type == "ARRAY_OF_STRING"))) {
+            reader.failed = true;
+        }
+        program->slots.push_back({std::string(name), std::string(type), arraySize, integerOnly});
+    }
+    reader.slotCount = program->slots.size();
+    reader.block(program->statements);
+    if (reader.failed || !reader.atEnd()) {
+        return nullptr;
+    }
+    // Mark the file as recently used so eviction keeps it
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return program;
+}
+
+void ProgramCache::store(const Program& program) const {
+    if (path.empty()) {
+        return;
+    }
+
+    std::string payload;
+    Writer writer(payload);
+    writer.u32(static_cast<uint32_t>(program.slots.size()));
+    for (const auto& slot : program.slots) {
+        writer.text(slot.name);
+        writer.text(slot.type);
+        writer.i32(slot.arraySize);
+        writer.u8(slot.integerOnly ? 1 : 0);
+    }
+    writer.block(program.statements);
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.versionHash = versionHash();
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.optimizationLevel = static_cast<uint32_t>(optimizationLevel);
+    header.payloadSize = payload.size();
+    header.payloadHash = hashBytes(payload);
+
+    // Write a private file and rename it into place, so a concurrent run
+    // never maps a half-written cache
+    std::error_code error;
+    std::filesystem::path target(path);
+    std::filesystem::create_directories(target.parent_path(), error);
+    if (error) {
+        return;
+    }
+    std::filesystem::path temporary = target;
+    temporary += "." + std::to_string(getpid());
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+    evictOldFiles(target.parent_path());
+}
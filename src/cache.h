@@ -0,0 +1,37 @@
+#pragma once
+#include "parser.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// On-disk cache of checked (and, at -O1, optimized) programs, so an
+// unchanged source skips lexing, parsing, resolution, type checking and
+// optimization on the next run. Files live in $XDG_CACHE_HOME/gov or
+// ~/.cache/gov and are named after a hash of the source, the interpreter
+// version and the optimization level. The directory is kept under 512 MB by
+// evicting the least recently used files after each store. Every failure is
+// silent: a cache that cannot be read or written just means the program is
+// built from source.
+class ProgramCache {
+private:
+    std::string path; // empty when no cache directory is known
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    int optimizationLevel = 0;
+
+public:
+    ProgramCache(std::string_view source, int optimizationLevel);
+
+    // The cached program for this source, or nullptr when there is none or
+    // the file is stale, truncated or otherwise damaged
+    std::unique_ptr<Program> load() const;
+    // Writes `program`, which must have been resolved and type checked
+    void store(const Program& program) const;
+
+    const std::string& getPath() const { return path; }
+};
+
+// 64-bit hash of `data`, fast enough to run over multi-megabyte sources on
+// every start
+uint64_t hashBytes(std::string_view data, uint64_t seed = 0);
@@ -0,0 +1,333 @@
+#include "closure.h"
+#include "output.h"
+#include "input.h"
+#include <iostream>
+
+using Kernel = Value (*)(const Value&, const Value&);
+
+// Binary operators are bound to an integer fast path plus the shared value
+// kernel. Operands that are plain variables or integer literals are read in
+// place instead of going through another closure call.
+template <typename IntOp>
+static ExprClosure bindBinary(Expression* left, Expression* right, ExprClosure leftFn, ExprClosure rightFn,
+                              IntOp intOp, Kernel kernel) {
+    auto leftId = dynamic_cast<Identifier*>(left);
+    auto rightId = dynamic_cast<Identifier*>(right);
+    auto rightLiteral = dynamic_cast<IntegerLiteral*>(right);
+
+    if (leftId && rightLiteral) {
+        int slot = leftId->slot;
+        int constant = rightLiteral->value;
+        return [slot, constant, intOp, kernel](Frame& frame) -> Value {
+            const Value& l = frame[slot];
+            if (l.isInt()) {
+                return intOp(l.asInt(), constant);
+            }
+            return kernel(l, constant);
+        };
+    }
+
+    if (leftId && rightId) {
+        int leftSlot = leftId->slot;
+        int rightSlot = rightId->slot;
+        return [leftSlot, rightSlot, intOp, kernel](Frame& frame) -> Value {
+            const Value& l = frame[leftSlot];
+            const Value& r = frame[rightSlot];
+            if (l.isInt() && r.isInt()) {
+                return intOp(l.asInt(), r.asInt());
+            }
+            return kernel(l, r);
+        };
+    }
+
+    return [leftFn = std::move(leftFn), rightFn = std::move(rightFn), intOp, kernel](Frame& frame) -> Value {
+        Value l = leftFn(frame);
+        Value r = rightFn(frame);
+        if (l.isInt() && r.isInt()) {
+            return intOp(l.asInt(), r.asInt());
+        }
+        return kernel(l, r);
+    };
+}
+
+// Both operands were proven to be integers by the TypeChecker, so the
+// closures skip the tag checks and never need the value kernel.
+template <typename IntOp>
+static ExprClosure bindIntBinary(Expression* left, Expression* right, ExprClosure leftFn, ExprClosure rightFn,
+                                 IntOp intOp) {
+    auto leftId = dynamic_cast<Identifier*>(left);
+    auto rightId = dynamic_cast<Identifier*>(right);
+    auto rightLiteral = dynamic_cast<IntegerLiteral*>(right);
+
+    if (leftId && rightLiteral) {
+        int slot = leftId->slot;
+        int constant = rightLiteral->value;
+        return [slot, constant, intOp](Frame& frame) -> Value { return intOp(frame[slot].asInt(), constant); };
+    }
+
+    if (leftId && rightId) {
+        int leftSlot = leftId->slot;
+        int rightSlot = rightId->slot;
+        return [leftSlot, rightSlot, intOp](Frame& frame) -> Value {
+            return intOp(frame[leftSlot].asInt(), frame[rightSlot].asInt());
+        };
+    }
+
+    return [leftFn = std::move(leftFn), rightFn = std::move(rightFn), intOp](Frame& frame) -> Value {
+        return intOp(leftFn(frame).asInt(), rightFn(frame).asInt());
+    };
+}
+
+template <typename IntOp>
+static ExprClosure bindOperator(BinaryOp* binOp, ExprClosure leftFn, ExprClosure rightFn, IntOp intOp, Kernel kernel) {
+    Expression* left = binOp->left.get();
+    Expression* right = binOp->right.get();
+    if (binOp->operands == OperandTypes::INT_INT) {
+        return bindIntBinary(left, right, std::move(leftFn), std::move(rightFn), intOp);
+    }
+    return bindBinary(left, right, std::move(leftFn), std::move(rightFn), intOp, kernel);
+}
+
+ExprClosure ClosureCompiler::compileBinary(BinaryOp* binOp) {
+    ExprClosure l = compileExpression(binOp->left.get());
+    ExprClosure r = compileExpression(binOp->right.get());
+
+    switch (binOp->op) {
+        case TokenType::PLUS:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a + b; }, addValues);
+        case TokenType::MINUS:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a - b; }, subtractValues);
+        case TokenType::MULTIPLY:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a * b; }, multiplyValues);
+        case TokenType::DIVIDE:
+            return bindOperator(binOp, l, r, [](int a, int b) { return b != 0 ? a / b : 0; }, divideValues);
+        case TokenType::EQUALS:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a == b ? 1 : 0; }, equalValues);
+        case TokenType::NOT_EQUALS:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a != b ? 1 : 0; }, notEqualValues);
+        case TokenType::LESS_THAN:
+            return bindOperator(binOp, l, r, [](int a, int b) { return a < b ? 1 : 0; }, lessThanValues);
+        case TokenType::AND:
+            return bindOperator(binOp, l, r, [](int a, int b) { return (a != 0 && b != 0) ? 1 : 0; }, andValues);
+        case TokenType::OR:
+            return bindOperator(binOp, l, r, [](int a, int b) { return (a != 0 || b != 0) ? 1 : 0; }, orValues);
+        default:
+            return [](Frame&) -> Value { return 0; };
+    }
+}
+
+ExprClosure ClosureCompiler::compileExpression(Expression* expr) {
+    if (auto literal = dynamic_cast<StringLiteral*>(expr)) {
+        Value value = literal->value;
+        return [value](Frame&) { return value; };
+    }
+
+    if (auto literal = dynamic_cast<IntegerLiteral*>(expr)) {
+        int value = literal->value;
+        return [value](Frame&) -> Value { return value; };
+    }
+
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        int slot = id->slot;
+        return [slot](Frame& frame) { return frame[slot]; };
+    }
+
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        auto id = dynamic_cast<Identifier*>(access->array.get());
+        if (!id) {
+            return [](Frame&) -> Value { return std::string(""); };
+        }
+        int slot = id->slot;
+        ExprClosure index = compileExpression(access->index.get());
+        return [slot, index = std::move(index)](Frame& frame) -> Value {
+            if (const Value* element = elementAt(frame[slot], index(frame))) {
+                return *element;
+            }
+            return std::string("");
+        };
+    }
+
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        return compileBinary(binOp);
+    }
+
+    return [](Frame&) -> Value { return 0; };
+}
+
+StmtClosure ClosureCompiler::compileBlock(const NodeList<Statement>& block) {
+    std::vector<StmtClosure> statements;
+    for (auto& stmt : block) {
+        statements.push_back(compileStatement(stmt.get()));
+        if (statementCounter) {
+            statements.back() = [counter = statementCounter, stmt = std::move(statements.back())](Frame& frame) {
+                ++*counter;
+                stmt(frame);
+            };
+        }
+    }
+
+    if (statements.size() == 1) {
+        return std::move(statements[0]);
+    }
+
+    return [statements = std::move(statements)](Frame& frame) {
+        for (const auto& stmt : statements) {
+            stmt(frame);
+        }
+    };
+}
+
+StmtClosure ClosureCompiler::compileStatement(Statement* stmt) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
+        ExprClosure expr = compileExpression(print->expr.get());
+        return [expr = std::move(expr)](Frame& frame) {
+            standardOutput().printLine(expr(frame));
+        };
+    }
+
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        if (decl->type.empty()) {
+            return [](Frame&) {};
+        }
+        int slot = decl->slot;
+        Value initial = defaultValue(decl->type, decl->arraySize);
+        return [slot, initial = std::move(initial)](Frame& frame) { frame[slot] = initial; };
+    }
+
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        int slot = assign->slot;
+
+        if (!assign->appendOperands.empty()) {
+            if (assign->appendOperands.size() == 1) {
+                if (auto literal = dynamic_cast<IntegerLiteral*>(assign->appendOperands[0])) {
+                    Value constant = literal->value;
+                    return [slot, constant](Frame& frame) { appendValues(frame[slot], constant); };
+                }
+            }
+
+            std::vector<ExprClosure> operands;
+            for (Expression* operand : assign->appendOperands) {
+                operands.push_back(compileExpression(operand));
+            }
+            return [slot, operands = std::move(operands)](Frame& frame) {
+                for (const auto& operand : operands) {
+                    appendValues(frame[slot], operand(frame));
+                }
+            };
+        }
+
+        ExprClosure value = compileExpression(assign->value.get());
+        if (assign->index) {
+            ExprClosure index = compileExpression(assign->index.get());
+            return [slot, value = std::move(value), index = std::move(index)](Frame& frame) {
+                Value newValue = value(frame);
+                if (frame[slot].isArray()) {
+                    storeElement(frame[slot], index(frame), newValue);
+                }
+            };
+        }
+
+        return [slot, value = std::move(value)](Frame& frame) { frame[slot] = value(frame); };
+    }
+
+    // Loops the JIT accepts run as native code; it compiles them up front
+    // here, since a closure is built once per loop anyway
+    if (jit && (dynamic_cast<ForLoop*>(stmt) || dynamic_cast<WhileLoop*>(stmt))) {
+        if (JitLoop* native = jit->loopFor(stmt)) {
+            return [native](Frame& frame) { native->run(frame); };
+        }
+    }
+
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        ExprClosure condition = compileExpression(forLoop->condition.get());
+        StmtClosure body = compileBlock(forLoop->body);
+        return [condition = std::move(condition), body = std::move(body)](Frame& frame) {
+            while (isTruthy(condition(frame))) {
+                body(frame);
+            }
+        };
+    }
+
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        ExprClosure condition = compileExpression(whileLoop->condition.get());
+        StmtClosure body = compileBlock(whileLoop->body);
+        return [condition = std::move(condition), body = std::move(body)](Frame& frame) {
+            while (isTruthy(condition(frame))) {
+                body(frame);
+            }
+        };
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        // ELSE_IF chains are folded from the back into nested if/else closures
+        StmtClosure otherwise = compileBlock(ifStmt->elseBranch);
+        for (auto it = ifStmt->elseIfClauses.rbegin(); it != ifStmt->elseIfClauses.rend(); ++it) {
+            ExprClosure condition = compileExpression(it->condition.get());
+            StmtClosure body = compileBlock(it->body);
+            otherwise = [condition = std::move(condition), body = std::move(body),
+                         otherwise = std::move(otherwise)](Frame& frame) {
+                if (isTruthy(condition(frame))) {
+                    body(frame);
+                } else {
+                    otherwise(frame);
+                }
+            };
+        }
+
+        ExprClosure condition = compileExpression(ifStmt->condition.get());
+        StmtClosure thenBranch = compileBlock(ifStmt->thenBranch);
+        return [condition = std::move(condition), thenBranch = std::move(thenBranch),
+                otherwise = std::move(otherwise)](Frame& frame) {
+            if (isTruthy(condition(frame))) {
+                thenBranch(frame);
+            } else {
+                otherwise(frame);
+            }
+        };
+    }
+
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        int slot = inc->slot;
+        int amount = inc->amount;
+        return [slot, amount](Frame& frame) {
+            if (frame[slot].isInt()) {
+                frame[slot] = frame[slot].asInt() + amount;
+            }
+        };
+    }
+
+    if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
+        int slot = read->slot;
+        return [slot](Frame& frame) {
+            std::string_view input;
+            standardOutput().flushForInput();
+            standardInput().readLine(input);
+            frame[slot] = valueFromInput(input);
+        };
+    }
+
+    return [](Frame&) {};
+}
+
+StmtClosure ClosureCompiler::compile(Program* program) {
+    return compileBlock(program->statements);
+}
+
+void ClosureEngine::run(Program* program) {
+    frame.clear();
+    for (const auto& slot : program->slots) {
+        frame.push_back(defaultValue(slot.type, slot.arraySize));
+    }
+
+    std::unique_ptr<Jit> jit;
+    if (jitEnabled) {
+        jit = std::make_unique<Jit>(program);
+    }
+    ClosureCompiler compiler(jit.get());
+    statementsExecuted = 0;
+    if (countingStatements) {
+        compiler.countStatements(&statementsExecuted);
+    }
+    StmtClosure entry = compiler.compile(program);
+    entry(frame);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+#include "jit.h"
+#include <functional>
+#include <vector>
+
+using Frame = std::vector<Value>;
+using ExprClosure = std::function<Value(Frame&)>;
+using StmtClosure = std::function<void(Frame&)>;
+
+// Closure-compiling engine. A single pass over the resolved AST turns every
+// node into a callable with its children, slots and operator kernel already
+// bound, so execution never inspects node types again.
+class ClosureCompiler {
+private:
+    Jit* jit = nullptr;
+    uint64_t* statementCounter = nullptr;
+
+    ExprClosure compileExpression(Expression* expr);
+    ExprClosure compileBinary(BinaryOp* binOp);
+    StmtClosure compileStatement(Statement* stmt);
+    StmtClosure compileBlock(const NodeList<Statement>& block);
+
+public:
+    explicit ClosureCompiler(Jit* jit = nullptr) : jit(jit) {}
+
+    // Makes every compiled statement add one to `*counter` when it runs
+    void countStatements(uint64_t* counter) { statementCounter = counter; }
+
+    StmtClosure compile(Program* program);
+};
+
+class ClosureEngine {
+private:
+    Frame frame;
+    bool jitEnabled = false;
+    bool countingStatements = false;
+    uint64_t statementsExecuted = 0;
+
+public:
+    void setJitEnabled(bool enabled) { jitEnabled = enabled; }
+    // Counting wraps every statement closure, so it is off unless asked for
+    void setCountStatements(bool enabled) { countingStatements = enabled; }
+    void run(Program* program);
+
+    uint64_t getStatementsExecuted() const { return statementsExecuted; }
+};
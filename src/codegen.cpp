@@ -0,0 +1,417 @@
+#include "codegen.h"
+#include "value.h"
+#include "runtime_sources.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Helpers the generated code calls besides the value.h kernels
+static const char* preamble = R"gov_code(#include "value.h"
+#include "output.h"
+#include "input.h"
+
+static inline int divideInts(int left, int right) {
+    return right != 0 ? left / right : 0;
+}
+
+static inline Value loadElement(const Value& array, const Value& index) {
+    if (const Value* element = elementAt(array, index)) {
+        return *element;
+    }
+    return Value("");
+}
+
+static inline Value readValue() {
+    std::string_view input;
+    standardOutput().flushForInput();
+    standardInput().readLine(input);
+    return valueFromInput(input);
+}
+)gov_code";
+
+std::string CodeGenerator::variable(int slot) const {
+    return "v" + std::to_string(slot);
+}
+
+bool CodeGenerator::isIntSlot(int slot) const {
+    return slot >= 0 && static_cast<size_t>(slot) < intSlots.size() && intSlots[slot];
+}
+
+// String literals become Value constants built once at the top of main().
+// Every byte outside printable ASCII is written as a three digit octal
+// escape so the text survives unchanged, including embedded quotes.
+std::string CodeGenerator::stringConstant(std::string_view text) {
+    auto found = constantNames.find(std::string(text));
+    if (found != constantNames.end()) {
+        return found->second;
+    }
+
+    std::string literal = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\' || c == '?' || c < 0x20 || c > 0x7e) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\%03o", c);
+            literal += escape;
+        } else {
+            literal += static_cast<char>(c);
+        }
+    }
+    literal += "\"";
+
+    std::string name = "s" + std::to_string(constants.size());
+    constants.push_back("const Value " + name + "(std::string_view(" + literal + ", " +
+                        std::to_string(text.size()) + "));");
+    constantNames.emplace(std::string(text), name);
+    return name;
+}
+
+std::string CodeGenerator::valueOf(const Code& code) const {
+    return code.isInt ? "Value(" + code.text + ")" : code.text;
+}
+
+// Only used where the TypeChecker guarantees an integer at run time
+std::string CodeGenerator::intOf(const Code& code) const {
+    return code.isInt ? code.text : code.text + ".asInt()";
+}
+
+std::string CodeGenerator::condition(Expression* expr) {
+    Code code = expression(expr);
+    if (code.isInt) {
+        return code.text + " != 0";
+    }
+    return "isTruthy(" + code.text + ")";
+}
+
+CodeGenerator::Code CodeGenerator::expression(Expression* expr) {
+    if (auto literal = dynamic_cast<StringLiteral*>(expr)) {
+        return {stringConstant(literal->value), false};
+    }
+
+    if (auto literal = dynamic_cast<IntegerLiteral*>(expr)) {
+        if (literal->value == INT32_MIN) {
+            return {"(-2147483647 - 1)", true};
+        }
+        return {literal->value < 0 ? "(" + std::to_string(literal->value) + ")" : std::to_string(literal->value),
+                true};
+    }
+
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        if (id->slot < 0) {
+            return {"0", true};
+        }
+        return {variable(id->slot), isIntSlot(id->slot)};
+    }
+
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        auto id = dynamic_cast<Identifier*>(access->array.get());
+        if (!id || id->slot < 0 || isIntSlot(id->slot)) {
+            return {stringConstant(""), false};
+        }
+        Code index = expression(access->index.get());
+        return {"loadElement(" + variable(id->slot) + ", " + valueOf(index) + ")", false};
+    }
+
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        return binary(binOp);
+    }
+
+    return {"0", true};
+}
+
+CodeGenerator::Code CodeGenerator::binary(BinaryOp* binOp) {
+    Code left = expression(binOp->left.get());
+    Code right = expression(binOp->right.get());
+
+    // Integer operands compile to plain C++ arithmetic (built with -fwrapv,
+    // so overflow wraps like it does in the engines)
+    if (left.isInt && right.isInt) {
+        std::string l = left.text;
+        std::string r = right.text;
+        switch (binOp->op) {
+            case TokenType::PLUS: return {"(" + l + " + " + r + ")", true};
+            case TokenType::MINUS: return {"(" + l + " - " + r + ")", true};
+            case TokenType::MULTIPLY: return {"(" + l + " * " + r + ")", true};
+            case TokenType::DIVIDE: return {"divideInts(" + l + ", " + r + ")", true};
+            case TokenType::EQUALS: return {"int(" + l + " == " + r + ")", true};
+            case TokenType::NOT_EQUALS: return {"int(" + l + " != " + r + ")", true};
+            case TokenType::LESS_THAN: return {"int(" + l + " < " + r + ")", true};
+            case TokenType::AND: return {"int((" + l + " != 0) & (" + r + " != 0))", true};
+            case TokenType::OR: return {"int((" + l + " != 0) | (" + r + " != 0))", true};
+            default: return {"0", true};
+        }
+    }
+
+    const char* kernel = nullptr;
+    switch (binOp->op) {
+        case TokenType::PLUS: kernel = "addValues"; break;
+        case TokenType::MINUS: kernel = "subtractValues"; break;
+        case TokenType::MULTIPLY: kernel = "multiplyValues"; break;
+        case TokenType::DIVIDE: kernel = "divideValues"; break;
+        case TokenType::EQUALS: kernel = "equalValues"; break;
+        case TokenType::NOT_EQUALS: kernel = "notEqualValues"; break;
+        case TokenType::LESS_THAN: kernel = "lessThanValues"; break;
+        case TokenType::AND: kernel = "andValues"; break;
+        case TokenType::OR: kernel = "orValues"; break;
+        default: return {"0", true};
+    }
+    return {std::string(kernel) + "(" + valueOf(left) + ", " + valueOf(right) + ")", false};
+}
+
+void CodeGenerator::line(const std::string& text) {
+    out.append(depth * 4, ' ');
+    out += text;
+    out += '\n';
+}
+
+void CodeGenerator::block(const NodeList<Statement>& statements) {
+    depth++;
+    for (auto& stmt : statements) {
+        statement(stmt.get());
+    }
+    depth--;
+}
+
+void CodeGenerator::statement(Statement* stmt) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
+        line("standardOutput().printLine(" + valueOf(expression(print->expr.get())) + ");");
+        return;
+    }
+
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        if (decl->type.empty() || decl->slot < 0) {
+            return;
+        }
+        std::string name = variable(decl->slot);
+        if (isIntSlot(decl->slot)) {
+            line(name + " = 0;");
+        } else if (decl->type == "STRING") {
+            line(name + " = " + stringConstant("") + ";");
+        } else if (decl->type == "ARRAY_OF_STRING") {
+            line(name + " = Value::array(" + std::to_string(decl->arraySize) + ", " + stringConstant(" ") + ");");
+        } else {
+            line(name + " = Value(0);");
+        }
+        return;
+    }
+
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        if (assign->slot < 0) {
+            return;
+        }
+        std::string name = variable(assign->slot);
+        bool intTarget = isIntSlot(assign->slot);
+
+        if (!assign->appendOperands.empty()) {
+            for (Expression* operand : assign->appendOperands) {
+                Code code = expression(operand);
+                if (intTarget) {
+                    line(name + " = " + name + " + " + intOf(code) + ";");
+                } else {
+                    line("appendValues(" + name + ", " + valueOf(code) + ");");
+                }
+            }
+            return;
+        }
+
+        Code value = expression(assign->value.get());
+        if (assign->index) {
+            // Subscripted stores into a scalar are rejected by the TypeChecker
+            if (!intTarget) {
+                Code index = expression(assign->index.get());
+                line("storeElement(" + name + ", " + valueOf(index) + ", " + valueOf(value) + ");");
+            }
+        } else if (intTarget) {
+            line(name + " = " + intOf(value) + ";");
+        } else {
+            line(name + " = " + valueOf(value) + ";");
+        }
+        return;
+    }
+
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        line("while (" + condition(forLoop->condition.get()) + ") {");
+        block(forLoop->body);
+        line("}");
+        return;
+    }
+
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        line("while (" + condition(whileLoop->condition.get()) + ") {");
+        block(whileLoop->body);
+        line("}");
+        return;
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        line("if (" + condition(ifStmt->condition.get()) + ") {");
+        block(ifStmt->thenBranch);
+        for (auto& clause : ifStmt->elseIfClauses) {
+            line("} else if (" + condition(clause.condition.get()) + ") {");
+            block(clause.body);
+        }
+        if (!ifStmt->elseBranch.empty()) {
+            line("} else {");
+            block(ifStmt->elseBranch);
+        }
+        line("}");
+        return;
+    }
+
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        if (inc->slot < 0) {
+            return;
+        }
+        std::string name = variable(inc->slot);
+        std::string amount = "(" + std::to_string(inc->amount) + ")";
+        if (isIntSlot(inc->slot)) {
+            line(name + " = " + name + " + " + amount + ";");
+        } else {
+            line("if (" + name + ".isInt()) " + name + " = " + name + ".asInt() + " + amount + ";");
+        }
+        return;
+    }
+
+    if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
+        if (read->slot >= 0 && !isIntSlot(read->slot)) {
+            line(variable(read->slot) + " = readValue();");
+        }
+        return;
+    }
+}
+
+std::string CodeGenerator::generate(Program* program, const std::string& sourceName, const std::string& flush) {
+    intSlots.clear();
+    constants.clear();
+    constantNames.clear();
+    out.clear();
+    depth = 0;
+
+    // Integer-only slots whose initial value is an integer are plain ints
+    for (const auto& slot : program->slots) {
+        intSlots.push_back(slot.integerOnly && defaultValue(slot.type, slot.arraySize).isInt());
+    }
+
+    block(program->statements);
+    std::string body = std::move(out);
+
+    std::string code = "// Generated by gov compile from " + sourceName + "\n";
+    code += preamble;
+    code += "\nint main() {\n";
+    if (flush.empty()) {
+        code += "    standardOutput().setPolicy(stdoutIsTerminal() ? FlushPolicy::LINE : FlushPolicy::FULL);\n";
+    } else {
+        code += "    FlushPolicy policy;\n";
+        code += "    parseFlushPolicy(\"" + flush + "\", policy);\n";
+        code += "    standardOutput().setPolicy(policy);\n";
+    }
+    for (const auto& constant : constants) {
+        code += "    " + constant + "\n";
+    }
+    for (size_t i = 0; i < program->slots.size(); ++i) {
+        const VariableSlot& slot = program->slots[i];
+        std::string name = variable(static_cast<int>(i));
+        if (intSlots[i]) {
+            code += "    int " + name + " = 0;";
+        } else {
+            code += "    Value " + name + " = defaultValue(\"" + slot.type + "\", " + std::to_string(slot.arraySize) +
+                    ");";
+        }
+        code += " // " + slot.name + "\n";
+    }
+    code += body;
+    code += "    return 0;\n}\n";
+    return code;
+}
+
+// Single-quotes an argument for the POSIX shell, or double-quotes it for cmd
+static std::string quote(const std::string& arg) {
+#ifdef _WIN32
+    return "\"" + arg + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+#endif
+}
+
+// Creates a new file, failing rather than following a name someone else
+// already put there
+static bool writeFile(const std::filesystem::path& path, const std::string& text) {
+    std::FILE* file = std::fopen(path.string().c_str(), "wbx");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    return std::fclose(file) == 0 && written;
+}
+
+// Creates a fresh directory under the temporary directory that only this
+// user can enter. Unlike a name derived from the pid, a directory another
+// user created in advance is never reused.
+static bool makePrivateDirectory(std::filesystem::path& dir) {
+    std::error_code ec;
+    std::string name = (std::filesystem::temp_directory_path(ec) / "gov-compile-XXXXXX").string();
+    if (ec) {
+        return false;
+    }
+#ifdef _WIN32
+    if (_mktemp_s(name.data(), name.size() + 1) != 0 || _mkdir(name.c_str()) != 0) {
+        return false;
+    }
+#else
+    if (!mkdtemp(name.data())) {
+        return false;
+    }
+#endif
+    dir = name;
+    return true;
+}
+
+bool buildExecutable(const std::string& source, const std::string& outputPath) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path dir;
+    if (!makePrivateDirectory(dir)) {
+        std::cerr << "Error: Could not create a temporary directory for the generated sources" << std::endl;
+        return false;
+    }
+
+    bool written = writeFile(dir / "main.cpp", source);
+    for (const auto& file : runtimeSources) {
+        written = written && writeFile(dir / file.name, file.text);
+    }
+    if (!written) {
+        std::cerr << "Error: Could not write the generated sources to " << dir.string() << std::endl;
+        fs::remove_all(dir, ec);
+        return false;
+    }
+
+    const char* cxx = std::getenv("CXX");
+    std::string command = quote(cxx && *cxx ? cxx : "c++") + " -std=c++17 -O2 -fwrapv -I " + quote(dir.string());
+    for (const char* unit : {"main.cpp", "value.cpp", "output.cpp", "input.cpp"}) {
+        command += " " + quote((dir / unit).string());
+    }
+    command += " -o " + quote(outputPath);
+
+    int status = std::system(command.c_str());
+    fs::remove_all(dir, ec);
+    if (status != 0) {
+        std::cerr << "Error: C++ compiler failed: " << command << std::endl;
+        return false;
+    }
+    return true;
+}
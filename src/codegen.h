@@ -0,0 +1,49 @@
+#pragma once
+#include "parser.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Ahead-of-time backend (gov compile). Turns a resolved and type checked
+// Program into a standalone C++ translation unit that links against the
+// same runtime the engines use (value.h, output, input), so the native
+// program prints exactly what the interpreter would.
+class CodeGenerator {
+private:
+    // A C++ expression and whether it has type int rather than Value
+    struct Code {
+        std::string text;
+        bool isInt;
+    };
+
+    std::vector<bool> intSlots; // slots stored as plain ints
+    std::vector<std::string> constants;
+    std::unordered_map<std::string, std::string> constantNames; // text -> constant
+    std::string out;
+    int depth = 0;
+
+    std::string variable(int slot) const;
+    bool isIntSlot(int slot) const;
+    std::string stringConstant(std::string_view text);
+
+    Code expression(Expression* expr);
+    Code binary(BinaryOp* binOp);
+    std::string valueOf(const Code& code) const;
+    std::string intOf(const Code& code) const;
+    std::string condition(Expression* expr);
+
+    void line(const std::string& text);
+    void statement(Statement* stmt);
+    void block(const NodeList<Statement>& statements);
+
+public:
+    // `flush` is a --flush= policy name to bake in; empty decides at run
+    // time like gov run does
+    std::string generate(Program* program, const std::string& sourceName, const std::string& flush);
+};
+
+// Writes `source` and the runtime into a temporary directory and builds it
+// with the C++ compiler named by $CXX (default c++). Returns false and
+// reports on std::cerr when the compiler fails.
+bool buildExecutable(const std::string& source, const std::string& outputPath);
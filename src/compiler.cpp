@@ -0,0 +1,265 @@
+#include "compiler.h"
+#include <iostream>
+#include <iomanip>
+
+int32_t Compiler::addConstant(Value value) {
+    chunk.constants.push_back(std::move(value));
+    return static_cast<int32_t>(chunk.constants.size() - 1);
+}
+
+size_t Compiler::emit(OpCode op, uint32_t a, int32_t b) {
+    chunk.code.push_back({op, a, b});
+    return chunk.code.size() - 1;
+}
+
+void Compiler::patchJump(size_t jump) {
+    chunk.code[jump].b = static_cast<int32_t>(chunk.code.size() - jump - 1);
+}
+
+void Compiler::emitJumpBack(size_t target) {
+    size_t jump = emit(OpCode::JUMP);
+    chunk.code[jump].b = static_cast<int32_t>(target) - static_cast<int32_t>(jump + 1);
+}
+
+void Compiler::compileExpression(Expression* expr) {
+    if (auto literal = dynamic_cast<StringLiteral*>(expr)) {
+        emit(OpCode::CONSTANT, 0, addConstant(literal->value));
+        return;
+    }
+
+    if (auto literal = dynamic_cast<IntegerLiteral*>(expr)) {
+        emit(OpCode::CONSTANT, 0, addConstant(literal->value));
+        return;
+    }
+
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        emit(OpCode::LOAD_GLOBAL, id->slot);
+        return;
+    }
+
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        // Elements are read straight out of the global, the array itself is
+        // never pushed on the stack.
+        if (auto id = dynamic_cast<Identifier*>(access->array.get())) {
+            compileExpression(access->index.get());
+            emit(OpCode::LOAD_ELEMENT, id->slot);
+        } else {
+            emit(OpCode::CONSTANT, 0, addConstant(std::string("")));
+        }
+        return;
+    }
+
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        OpCode op;
+        switch (binOp->op) {
+            case TokenType::PLUS: op = OpCode::ADD; break;
+            case TokenType::MINUS: op = OpCode::SUBTRACT; break;
+            case TokenType::MULTIPLY: op = OpCode::MULTIPLY; break;
+            case TokenType::DIVIDE: op = OpCode::DIVIDE; break;
+            case TokenType::EQUALS: op = OpCode::EQUALS; break;
+            case TokenType::NOT_EQUALS: op = OpCode::NOT_EQUALS; break;
+            case TokenType::LESS_THAN: op = OpCode::LESS_THAN; break;
+            case TokenType::AND: op = OpCode::AND; break;
+            case TokenType::OR: op = OpCode::OR; break;
+            default:
+                // Unknown operators evaluate to 0, same as the interpreter
+                emit(OpCode::CONSTANT, 0, addConstant(0));
+                return;
+        }
+        if (binOp->operands == OperandTypes::INT_INT) {
+            switch (op) {
+                case OpCode::ADD: op = OpCode::ADD_INT; break;
+                case OpCode::SUBTRACT: op = OpCode::SUBTRACT_INT; break;
+                case OpCode::MULTIPLY: op = OpCode::MULTIPLY_INT; break;
+                case OpCode::DIVIDE: op = OpCode::DIVIDE_INT; break;
+                case OpCode::EQUALS: op = OpCode::EQUALS_INT; break;
+                case OpCode::NOT_EQUALS: op = OpCode::NOT_EQUALS_INT; break;
+                case OpCode::LESS_THAN: op = OpCode::LESS_THAN_INT; break;
+                default: break;
+            }
+        }
+        compileExpression(binOp->left.get());
+        compileExpression(binOp->right.get());
+        emit(op);
+        return;
+    }
+
+    emit(OpCode::CONSTANT, 0, addConstant(0));
+}
+
+void Compiler::compileBlock(const NodeList<Statement>& block) {
+    for (auto& stmt : block) {
+        compileStatement(stmt.get());
+    }
+}
+
+void Compiler::compileStatement(Statement* stmt) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
+        compileExpression(print->expr.get());
+        emit(OpCode::PRINT);
+        return;
+    }
+
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        if (!decl->type.empty()) {
+            emit(OpCode::CONSTANT, 0, addConstant(defaultValue(decl->type, decl->arraySize)));
+            emit(OpCode::STORE_GLOBAL, decl->slot);
+        }
+        return;
+    }
+
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        if (!assign->appendOperands.empty()) {
+            for (Expression* operand : assign->appendOperands) {
+                compileExpression(operand);
+                emit(OpCode::APPEND, assign->slot);
+            }
+            return;
+        }
+
+        compileExpression(assign->value.get());
+        if (assign->index) {
+            compileExpression(assign->index.get());
+            emit(OpCode::STORE_ELEMENT, assign->slot);
+        } else {
+            emit(OpCode::STORE_GLOBAL, assign->slot);
+        }
+        return;
+    }
+
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        size_t loopStart = chunk.code.size();
+        compileExpression(forLoop->condition.get());
+        size_t exitJump = emit(OpCode::JUMP_IF_FALSE);
+        compileBlock(forLoop->body);
+        emitJumpBack(loopStart);
+        patchJump(exitJump);
+        return;
+    }
+
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        size_t loopStart = chunk.code.size();
+        compileExpression(whileLoop->condition.get());
+        size_t exitJump = emit(OpCode::JUMP_IF_FALSE);
+        compileBlock(whileLoop->body);
+        emitJumpBack(loopStart);
+        patchJump(exitJump);
+        return;
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        std::vector<size_t> endJumps;
+
+        compileExpression(ifStmt->condition.get());
+        size_t nextJump = emit(OpCode::JUMP_IF_FALSE);
+        compileBlock(ifStmt->thenBranch);
+        endJumps.push_back(emit(OpCode::JUMP));
+        patchJump(nextJump);
+
+        for (auto& elseIfClause : ifStmt->elseIfClauses) {
+            compileExpression(elseIfClause.condition.get());
+            nextJump = emit(OpCode::JUMP_IF_FALSE);
+            compileBlock(elseIfClause.body);
+            endJumps.push_back(emit(OpCode::JUMP));
+            patchJump(nextJump);
+        }
+
+        compileBlock(ifStmt->elseBranch);
+        for (size_t jump : endJumps) {
+            patchJump(jump);
+        }
+        return;
+    }
+
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        emit(OpCode::INCREMENT, inc->slot, inc->amount);
+        return;
+    }
+
+    if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
+        emit(OpCode::READ, read->slot);
+        return;
+    }
+}
+
+Chunk Compiler::compile(Program* program) {
+    chunk = Chunk();
+    chunk.globals = program->slots;
+
+    compileBlock(program->statements);
+    emit(OpCode::HALT);
+
+    return std::move(chunk);
+}
+
+static const char* opCodeName(OpCode op) {
+    switch (op) {
+        case OpCode::CONSTANT: return "CONSTANT";
+        case OpCode::LOAD_GLOBAL: return "LOAD_GLOBAL";
+        case OpCode::STORE_GLOBAL: return "STORE_GLOBAL";
+        case OpCode::LOAD_ELEMENT: return "LOAD_ELEMENT";
+        case OpCode::STORE_ELEMENT: return "STORE_ELEMENT";
+        case OpCode::INCREMENT: return "INCREMENT";
+        case OpCode::APPEND: return "APPEND";
+        case OpCode::READ: return "READ";
+        case OpCode::PRINT: return "PRINT";
+        case OpCode::ADD: return "ADD";
+        case OpCode::SUBTRACT: return "SUBTRACT";
+        case OpCode::MULTIPLY: return "MULTIPLY";
+        case OpCode::DIVIDE: return "DIVIDE";
+        case OpCode::EQUALS: return "EQUALS";
+        case OpCode::NOT_EQUALS: return "NOT_EQUALS";
+        case OpCode::LESS_THAN: return "LESS_THAN";
+        case OpCode::AND: return "AND";
+        case OpCode::OR: return "OR";
+        case OpCode::ADD_INT: return "ADD_INT";
+        case OpCode::SUBTRACT_INT: return "SUBTRACT_INT";
+        case OpCode::MULTIPLY_INT: return "MULTIPLY_INT";
+        case OpCode::DIVIDE_INT: return "DIVIDE_INT";
+        case OpCode::EQUALS_INT: return "EQUALS_INT";
+        case OpCode::NOT_EQUALS_INT: return "NOT_EQUALS_INT";
+        case OpCode::LESS_THAN_INT: return "LESS_THAN_INT";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::HALT: return "HALT";
+    }
+    return "UNKNOWN";
+}
+
+void disassemble(const Chunk& chunk) {
+    for (size_t i = 0; i < chunk.code.size(); i++) {
+        const Instruction& instr = chunk.code[i];
+        std::cout << std::setw(5) << i << "  " << std::left << std::setw(14) << opCodeName(instr.op) << std::right;
+
+        switch (instr.op) {
+            case OpCode::CONSTANT: {
+                const Value& constant = chunk.constants[instr.b];
+                if (constant.isString()) {
+                    std::cout << "\"" << valueToString(constant) << "\"";
+                } else {
+                    std::cout << valueToString(constant);
+                }
+                break;
+            }
+            case OpCode::LOAD_GLOBAL:
+            case OpCode::STORE_GLOBAL:
+            case OpCode::LOAD_ELEMENT:
+            case OpCode::STORE_ELEMENT:
+            case OpCode::APPEND:
+            case OpCode::READ:
+                std::cout << chunk.globals[instr.a].name;
+                break;
+            case OpCode::INCREMENT:
+                std::cout << chunk.globals[instr.a].name << " BY " << instr.b;
+                break;
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_FALSE:
+                std::cout << "-> " << static_cast<int64_t>(i) + 1 + instr.b;
+                break;
+            default:
+                break;
+        }
+
+        std::cout << "\n";
+    }
+}
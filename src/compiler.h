@@ -0,0 +1,70 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bytecode instruction set. Operand meanings are listed next to each opcode;
+// jump offsets in `b` are relative to the instruction that follows the jump.
+enum class OpCode : uint8_t {
+    CONSTANT,       // push constants[b]
+    LOAD_GLOBAL,    // push globals[a]
+    STORE_GLOBAL,   // globals[a] = pop()
+    LOAD_ELEMENT,   // index = pop(); push globals[a][index]
+    STORE_ELEMENT,  // index = pop(); value = pop(); globals[a][index] = value
+    INCREMENT,      // globals[a] += b when it holds an integer
+    APPEND,         // globals[a] = globals[a] + pop(), in place for strings
+    READ,           // globals[a] = next line of standard input
+    PRINT,          // print pop()
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    EQUALS,
+    NOT_EQUALS,
+    LESS_THAN,
+    AND,
+    OR,
+    ADD_INT,        // integer-only forms, emitted when the TypeChecker
+    SUBTRACT_INT,   // proved both operands are integers
+    MULTIPLY_INT,
+    DIVIDE_INT,
+    EQUALS_INT,
+    NOT_EQUALS_INT,
+    LESS_THAN_INT,
+    JUMP,           // ip += b
+    JUMP_IF_FALSE,  // if pop() is falsy: ip += b
+    HALT
+};
+
+struct Instruction {
+    OpCode op;
+    uint32_t a;
+    int32_t b;
+};
+
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<VariableSlot> globals; // copied from Program::slots
+};
+
+class Compiler {
+private:
+    Chunk chunk;
+
+    int32_t addConstant(Value value);
+    size_t emit(OpCode op, uint32_t a = 0, int32_t b = 0);
+    void patchJump(size_t jump);
+    void emitJumpBack(size_t target);
+
+    void compileExpression(Expression* expr);
+    void compileStatement(Statement* stmt);
+    void compileBlock(const NodeList<Statement>& block);
+
+public:
+    Chunk compile(Program* program);
+};
+
+void disassemble(const Chunk& chunk);
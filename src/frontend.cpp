@@ -0,0 +1,240 @@
+#include "frontend.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Slices are at least this large, so each one has room for a split point
+constexpr size_t MIN_SLICE_SIZE = 256 * 1024;
+// More slices than threads keep every thread busy when pieces differ in cost
+constexpr size_t SLICES_PER_THREAD = 4;
+constexpr size_t NO_SPLIT = std::numeric_limits<size_t>::max();
+
+struct Split {
+    size_t offset = NO_SPLIT; // a line start
+    int newlines = 0;         // between the slice start and the split
+};
+
+// What the pre-scan found in one slice of the source
+struct Slice {
+    size_t begin = 0;
+    size_t end = 0;
+    int depthChange = 0; // blocks opened minus blocks closed
+    int newlines = 0;
+    bool endsInString = false;
+    // splits[d]: the first line starting with a statement at d blocks
+    // fewer than the slice starts in, i.e. at the top level when the
+    // slice starts d blocks deep
+    std::vector<Split> splits;
+};
+
+// A piece of the source that is parsed on its own
+struct Chunk {
+    size_t begin;
+    size_t end;
+    int line; // line number of `begin`
+};
+
+bool startsStatement(TokenType type) {
+    switch (type) {
+        case TokenType::PRAISE_LEADER:
+        case TokenType::PLEASE:
+        case TokenType::FOR_THE_PEOPLE:
+        case TokenType::WHILE:
+        case TokenType::IF:
+        case TokenType::OBEY_PARTY_LINE:
+        case TokenType::DENOUNCE_IMPERIALIST_ERRORS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int depthChange(TokenType type) {
+    switch (type) {
+        case TokenType::FOR_THE_PEOPLE:
+        case TokenType::WHILE:
+        case TokenType::IF:
+            return 1;
+        case TokenType::END_FOR_THE_PEOPLE:
+        case TokenType::END_WHILE:
+        case TokenType::END_IF:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+// Lexes slice.[from, end) tracking block depth and candidate split points.
+// `newlines` counts the newlines in [slice.begin, from).
+void scanSlice(std::string_view source, Slice& slice, size_t from, int newlines, bool atLineStart) {
+    Lexer lexer(source.substr(0, slice.end), from, 1 + newlines, false);
+    int depth = 0;
+    bool lineStart = atLineStart;
+    bool skipLine = false; // rest of an OBEY_PARTY_LINE or similar, which the parser ignores
+    Token token = lexer.next();
+    while (token.type != TokenType::EOF_TOKEN) {
+        if (token.type == TokenType::NEWLINE) {
+            lineStart = true;
+            skipLine = false;
+        } else {
+            if (lineStart && depth <= 0 && startsStatement(token.type)) {
+                size_t level = static_cast<size_t>(-depth);
+                if (level >= slice.splits.size()) {
+                    slice.splits.resize(level + 1);
+                }
+                if (slice.splits[level].offset == NO_SPLIT) {
+                    slice.splits[level] = {token.offset - (token.column - 1), token.line - 1};
+                }
+            }
+            if (!skipLine) {
+                depth += depthChange(token.type);
+                skipLine = token.type == TokenType::OBEY_PARTY_LINE ||
+                           token.type == TokenType::DENOUNCE_IMPERIALIST_ERRORS;
+            }
+            lineStart = false;
+        }
+        token = lexer.next();
+    }
+    if (lexer.endsInString()) {
+        // That EOF_TOKEN carries the line the string began on
+        token = lexer.next();
+    }
+    slice.depthChange = depth;
+    slice.newlines = token.line - 1;
+    slice.endsInString = lexer.endsInString();
+}
+
+// Runs work(0) .. work(count - 1) on up to `threads` threads
+template <typename Work>
+void runParallel(size_t count, unsigned threads, const Work& work) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min<size_t>(threads, count); i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+std::unique_ptr<Program> parseSequential(std::string_view source, int* diagnostics) {
+    Lexer lexer(source);
+    Parser parser(lexer);
+    std::unique_ptr<Program> program = parser.parse();
+    if (diagnostics) {
+        *diagnostics = lexer.errorCount() + parser.errorCount();
+    }
+    return program;
+}
+
+} // namespace
+
+std::unique_ptr<Program> parseSource(std::string_view source, unsigned threads, int* diagnostics) {
+    if (diagnostics) {
+        *diagnostics = 0;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == 1 || source.size() < PARALLEL_PARSE_THRESHOLD) {
+        return parseSequential(source, diagnostics);
+    }
+
+    // Cut the source into slices at line starts and pre-scan them in
+    // parallel, each as if it began at the top level outside any string
+    size_t sliceCount = std::min(threads * SLICES_PER_THREAD, source.size() / MIN_SLICE_SIZE);
+    std::vector<Slice> slices;
+    size_t begin = 0;
+    for (size_t i = 1; i <= sliceCount && begin < source.size(); i++) {
+        size_t end = source.size();
+        if (i < sliceCount) {
+            size_t newline = source.find('\n', std::max(begin, source.size() / sliceCount * i));
+            end = newline == std::string_view::npos ? source.size() : newline + 1;
+        }
+        slices.emplace_back();
+        slices.back().begin = begin;
+        slices.back().end = end;
+        begin = end;
+    }
+    runParallel(slices.size(), threads, [&](size_t i) {
+        scanSlice(source, slices[i], slices[i].begin, 0, true);
+    });
+
+    // A string literal that runs over a slice boundary invalidates the
+    // next slice's scan. Such strings are rare, so rescan those slices here
+    // from the closing quote.
+    for (size_t i = 1; i < slices.size(); i++) {
+        if (!slices[i - 1].endsInString) {
+            continue;
+        }
+        Slice& slice = slices[i];
+        slice.splits.clear();
+        size_t quote = source.find('"', slice.begin);
+        if (quote == std::string_view::npos || quote >= slice.end) {
+            slice.depthChange = 0;
+            slice.newlines = static_cast<int>(std::count(source.begin() + slice.begin, source.begin() + slice.end, '\n'));
+            slice.endsInString = true;
+            continue;
+        }
+        int newlines = static_cast<int>(std::count(source.begin() + slice.begin, source.begin() + quote, '\n'));
+        scanSlice(source, slice, quote + 1, newlines, false);
+    }
+
+    // Split where a slice reaches the top level
+    std::vector<Chunk> chunks = {{0, 0, 1}};
+    int depth = 0;
+    int line = 1;
+    for (const Slice& slice : slices) {
+        if (depth >= 0 && static_cast<size_t>(depth) < slice.splits.size()) {
+            const Split& split = slice.splits[depth];
+            if (split.offset != NO_SPLIT && split.offset > chunks.back().begin) {
+                chunks.back().end = split.offset;
+                chunks.push_back({split.offset, 0, line + split.newlines});
+            }
+        }
+        depth += slice.depthChange;
+        line += slice.newlines;
+    }
+    chunks.back().end = source.size();
+    if (chunks.size() == 1) {
+        return parseSequential(source, diagnostics);
+    }
+
+    std::vector<std::unique_ptr<Program>> parts(chunks.size());
+    runParallel(chunks.size(), threads, [&](size_t i) {
+        Lexer lexer(source.substr(0, chunks[i].end), chunks[i].begin, chunks[i].line, false);
+        Parser parser(lexer, false);
+        parts[i] = parser.parseChunk(i == 0);
+    });
+    for (const auto& part : parts) {
+        if (!part) {
+            return parseSequential(source, diagnostics);
+        }
+    }
+
+    // Stitch the statement lists together; the pieces' arenas move into
+    // the program so their nodes live as long as it does
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part->statements.size();
+    }
+    std::unique_ptr<Program> program = std::move(parts[0]);
+    program->statements.reserve(total);
+    for (size_t i = 1; i < parts.size(); i++) {
+        NodeList<Statement>& statements = parts[i]->statements;
+        std::move(statements.begin(), statements.end(), std::back_inserter(program->statements));
+        program->chunkArenas.push_back(std::move(parts[i]->arena));
+    }
+    return program;
+}
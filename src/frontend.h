@@ -0,0 +1,17 @@
+#pragma once
+#include "parser.h"
+#include <memory>
+#include <string_view>
+
+// Sources at least this large are split and parsed in parallel
+constexpr size_t PARALLEL_PARSE_THRESHOLD = 1024 * 1024;
+
+// Lexes and parses `source` into a Program. Large sources are split at
+// top-level statement boundaries, meaning line starts outside any block and
+// any string literal, and the pieces are lexed and parsed on up to
+// `threads` threads (0: one per core) and stitched back together in order.
+// The tree is the same as a single Parser would build. Whenever a piece
+// does not parse cleanly the whole source is parsed again sequentially, so
+// diagnostics are also unchanged. When given, `diagnostics` receives the
+// number of lexer and parser errors that were reported.
+std::unique_ptr<Program> parseSource(std::string_view source, unsigned threads, int* diagnostics = nullptr);
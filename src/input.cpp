@@ -0,0 +1,70 @@
+#include "input.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+Input::Input() : buffer(BLOCK_SIZE) {}
+
+// Reads one more block after the unread bytes, moving them to the front or
+// growing the buffer when a single line is longer than it
+bool Input::fill() {
+    if (atEof) {
+        return false;
+    }
+    if (start > 0) {
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    if (end == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+#ifdef _WIN32
+    long count = _read(0, buffer.data() + end, static_cast<unsigned>(buffer.size() - end));
+#else
+    long count;
+    do {
+        count = ::read(0, buffer.data() + end, buffer.size() - end);
+    } while (count < 0 && errno == EINTR);
+#endif
+    if (count <= 0) {
+        atEof = true;
+        return false;
+    }
+    end += static_cast<size_t>(count);
+    return true;
+}
+
+bool Input::readLine(std::string_view& line) {
+    size_t scanned = start;
+    while (true) {
+        auto newline = static_cast<const char*>(
+            std::memchr(buffer.data() + scanned, '\n', end - scanned));
+        if (newline) {
+            size_t length = newline - (buffer.data() + start);
+            line = std::string_view(buffer.data() + start, length);
+            start += length + 1;
+            return true;
+        }
+
+        // fill() moves the unread bytes to the front of the buffer
+        size_t pending = end - start;
+        if (!fill()) {
+            line = std::string_view(buffer.data() + start, end - start);
+            start = end;
+            return !line.empty();
+        }
+        scanned = pending;
+    }
+}
+
+Input& standardInput() {
+    static Input input;
+    return input;
+}
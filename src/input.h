@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Line reader for READ. Standard input is read in large blocks with the raw
+// read call (which returns as soon as a terminal delivers a line), and each
+// line is handed out as a view into the block, so nothing is copied unless
+// a line straddles two blocks.
+class Input {
+private:
+    std::vector<char> buffer;
+    size_t start = 0; // first unread byte
+    size_t end = 0;   // one past the last byte read so far
+    bool atEof = false;
+
+    bool fill();
+
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    Input();
+
+    // Next line without its '\n'. At end of input it yields an empty line
+    // and returns false, like a failed std::getline. The view is valid
+    // until the next call.
+    bool readLine(std::string_view& line);
+};
+
+// The reader shared by all engines
+Input& standardInput();
@@ -1,9 +1,46 @@
 #include "interpreter.h"
+#include "output.h"
+#include "input.h"
+#include "profiler.h"
+#include "trace.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
 
-Value Interpreter::evaluate(Expression* expr) {
+// Identifiers resolve to their storage instead of a copy. Any other
+// expression is evaluated into `scratch`, which is then returned.
+template <typename Hooks>
+const Value& Interpreter<Hooks>::evaluateRef(Expression* expr, Value& scratch) {
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        return variables[id->slot];
+    }
+    
+    scratch = evaluate(expr);
+    return scratch;
+}
+
+// Points at the selected element inside the array variable, or returns
+// nullptr when the target is not an array or the index is out of range.
+// Only the index is evaluated; the array itself is never copied.
+template <typename Hooks>
+const Value* Interpreter<Hooks>::elementRef(ArrayAccess* access) {
+    auto id = dynamic_cast<Identifier*>(access->array.get());
+    if (!id) return nullptr;
+    
+    const Value& array = variables[id->slot];
+    if (!array.isArray()) return nullptr;
+    
+    Value indexScratch;
+    return elementAt(array, evaluateRef(access->index.get(), indexScratch));
+}
+
+template <typename Hooks>
+bool Interpreter<Hooks>::evaluateCondition(Expression* expr) {
+    Value scratch;
+    return isTruthy(evaluateRef(expr, scratch));
+}
+
+template <typename Hooks>
+Value Interpreter<Hooks>::evaluate(Expression* expr) {
     if (auto literal = dynamic_cast<StringLiteral*>(expr)) {
         return literal->value;
     }
@@ -13,81 +50,90 @@ Value Interpreter::evaluate(Expression* expr) {
     }
     
     if (auto id = dynamic_cast<Identifier*>(expr)) {
-        auto it = variables.find(id->name);
-        if (it != variables.end()) {
-            return it->second;
-        }
-        std::cerr << "Undefined variable: " << id->name << std::endl;
-        return 0;
+        return variables[id->slot];
     }
     
     if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
-        auto arrayValue = evaluate(access->array.get());
-        auto indexValue = evaluate(access->index.get());
-        
-        if (std::holds_alternative<std::vector<std::string>>(arrayValue) && 
-            std::holds_alternative<int>(indexValue)) {
-            auto& arr = std::get<std::vector<std::string>>(arrayValue);
-            int idx = std::get<int>(indexValue);
-            if (idx >= 0 && idx < arr.size()) {
-                return arr[idx];
-            }
+        if (auto element = elementRef(access)) {
+            return *element;
         }
         return std::string("");
     }
     
     if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
-        auto left = evaluate(binOp->left.get());
-        auto right = evaluate(binOp->right.get());
+        Value leftScratch, rightScratch;
+        const Value& left = evaluateRef(binOp->left.get(), leftScratch);
+        const Value& right = evaluateRef(binOp->right.get(), rightScratch);
+        if (binOp->operands == OperandTypes::INT_INT) {
+            return integerOperation(left.asInt(), binOp->op, right.asInt());
+        }
         return binaryOperation(left, binOp->op, right);
     }
     
     return 0;
 }
 
-void Interpreter::execute(Statement* stmt) {
+template <typename Hooks>
+void Interpreter<Hooks>::execute(Statement* stmt) {
+    hooks.beforeStatement(stmt, variables);
+    executeStatement(stmt);
+    hooks.afterStatement(stmt, variables);
+}
+
+template <typename Hooks>
+void Interpreter<Hooks>::executeStatement(Statement* stmt) {
     if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
-        auto value = evaluate(print->expr.get());
-        std::cout << valueToString(value) << std::endl;
+        Value scratch;
+        standardOutput().printLine(evaluateRef(print->expr.get(), scratch));
         return;
     }
     
     if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
-        if (decl->type == "INTEGER") {
-            variables[decl->name] = 0;
-        } else if (decl->type == "STRING") {
-            variables[decl->name] = std::string("");
-        } else if (decl->type == "ARRAY_OF_STRING") {
-            variables[decl->name] = std::vector<std::string>(decl->arraySize, " ");
+        if (!decl->type.empty()) {
+            variables[decl->slot] = defaultValue(decl->type, decl->arraySize);
+            hooks.variableWritten(variables, decl->slot, nullptr);
         }
         return;
     }
     
     if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        if (!assign->appendOperands.empty()) {
+            Value& target = variables[assign->slot];
+            for (Expression* operand : assign->appendOperands) {
+                Value scratch;
+                appendValues(target, evaluateRef(operand, scratch));
+            }
+            hooks.variableWritten(variables, assign->slot, nullptr);
+            return;
+        }
+
         auto value = evaluate(assign->value.get());
         
         if (assign->index) {
             // Array assignment
-            auto it = variables.find(assign->varName);
-            if (it != variables.end() && std::holds_alternative<std::vector<std::string>>(it->second)) {
-                auto indexValue = evaluate(assign->index.get());
-                if (std::holds_alternative<int>(indexValue)) {
-                    auto& arr = std::get<std::vector<std::string>>(it->second);
-                    int idx = std::get<int>(indexValue);
-                    if (idx >= 0 && idx < arr.size()) {
-                        arr[idx] = valueToString(value);
-                    }
-                }
+            Value& target = variables[assign->slot];
+            if (target.isArray()) {
+                Value indexScratch;
+                const Value& index = evaluateRef(assign->index.get(), indexScratch);
+                storeElement(target, index, value);
+                hooks.variableWritten(variables, assign->slot, &index);
             }
         } else {
             // Regular assignment
-            variables[assign->varName] = value;
+            variables[assign->slot] = std::move(value);
+            hooks.variableWritten(variables, assign->slot, nullptr);
         }
         return;
     }
     
     if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
-        while (isTruthy(evaluate(forLoop->condition.get()))) {
+        if (jit) {
+            if (JitLoop* native = jit->loopFor(stmt)) {
+                native->run(variables);
+                return;
+            }
+        }
+        while (evaluateCondition(forLoop->condition.get())) {
             for (auto& bodyStmt : forLoop->body) {
                 execute(bodyStmt.get());
             }
@@ -96,7 +142,13 @@ void Interpreter::execute(Statement* stmt) {
     }
     
     if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
-        while (isTruthy(evaluate(whileLoop->condition.get()))) {
+        if (jit) {
+            if (JitLoop* native = jit->loopFor(stmt)) {
+                native->run(variables);
+                return;
+            }
+        }
+        while (evaluateCondition(whileLoop->condition.get())) {
             for (auto& bodyStmt : whileLoop->body) {
                 execute(bodyStmt.get());
             }
@@ -105,7 +157,7 @@ void Interpreter::execute(Statement* stmt) {
     }
     
     if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
-        if (isTruthy(evaluate(ifStmt->condition.get()))) {
+        if (evaluateCondition(ifStmt->condition.get())) {
             for (auto& thenStmt : ifStmt->thenBranch) {
                 execute(thenStmt.get());
             }
@@ -113,7 +165,7 @@ void Interpreter::execute(Statement* stmt) {
             // Check ELSE_IF clauses
             bool executed = false;
             for (auto& elseIfClause : ifStmt->elseIfClauses) {
-                if (isTruthy(evaluate(elseIfClause.condition.get()))) {
+                if (evaluateCondition(elseIfClause.condition.get())) {
                     for (auto& elseIfStmt : elseIfClause.body) {
                         execute(elseIfStmt.get());
                     }
@@ -133,202 +185,158 @@ void Interpreter::execute(Statement* stmt) {
     }
     
     if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
-        auto it = variables.find(inc->varName);
-        if (it != variables.end() && std::holds_alternative<int>(it->second)) {
-            int currentValue = std::get<int>(it->second);
-            it->second = currentValue + inc->amount;
+        Value& target = variables[inc->slot];
+        if (target.isInt()) {
+            target = target.asInt() + inc->amount;
+            hooks.variableWritten(variables, inc->slot, nullptr);
         }
         return;
     }
     
     if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
-        std::string input;
-        std::getline(std::cin, input);
-        
-        // Try to parse as integer first
-        try {
-            int intValue = std::stoi(input);
-            variables[read->varName] = intValue;
-        } catch (...) {
-            variables[read->varName] = input;
-        }
+        std::string_view input;
+        standardOutput().flushForInput();
+        standardInput().readLine(input);
+        variables[read->slot] = valueFromInput(input);
+        hooks.variableWritten(variables, read->slot, nullptr);
         return;
     }
 }
 
-std::string Interpreter::valueToString(const Value& val) {
-    if (std::holds_alternative<int>(val)) {
-        return std::to_string(std::get<int>(val));
-    } else if (std::holds_alternative<std::string>(val)) {
-        return std::get<std::string>(val);
-    } else if (std::holds_alternative<std::vector<std::string>>(val)) {
-        auto& arr = std::get<std::vector<std::string>>(val);
-        std::stringstream ss;
-        ss << "[";
-        for (size_t i = 0; i < arr.size(); ++i) {
-            if (i > 0) ss << ", ";
-            ss << arr[i];
-        }
-        ss << "]";
-        return ss.str();
+template <typename Hooks>
+Value Interpreter<Hooks>::binaryOperation(const Value& left, TokenType op, const Value& right) {
+    switch (op) {
+        case TokenType::PLUS: return addValues(left, right);
+        case TokenType::MINUS: return subtractValues(left, right);
+        case TokenType::MULTIPLY: return multiplyValues(left, right);
+        case TokenType::DIVIDE: return divideValues(left, right);
+        case TokenType::EQUALS: return equalValues(left, right);
+        case TokenType::NOT_EQUALS: return notEqualValues(left, right);
+        case TokenType::LESS_THAN: return lessThanValues(left, right);
+        case TokenType::AND: return andValues(left, right);
+        case TokenType::OR: return orValues(left, right);
+        default: break;
     }
-    return "";
+    
+    return 0;
 }
 
-bool Interpreter::isTruthy(const Value& val) {
-    if (std::holds_alternative<int>(val)) {
-        return std::get<int>(val) != 0;
-    } else if (std::holds_alternative<std::string>(val)) {
-        return !std::get<std::string>(val).empty();
+// Operators on operands the TypeChecker proved to be integers
+template <typename Hooks>
+int Interpreter<Hooks>::integerOperation(int left, TokenType op, int right) {
+    switch (op) {
+        case TokenType::PLUS: return left + right;
+        case TokenType::MINUS: return left - right;
+        case TokenType::MULTIPLY: return left * right;
+        case TokenType::DIVIDE: return right != 0 ? left / right : 0;
+        case TokenType::EQUALS: return left == right ? 1 : 0;
+        case TokenType::NOT_EQUALS: return left != right ? 1 : 0;
+        case TokenType::LESS_THAN: return left < right ? 1 : 0;
+        case TokenType::AND: return (left != 0 && right != 0) ? 1 : 0;
+        case TokenType::OR: return (left != 0 || right != 0) ? 1 : 0;
+        default: return 0;
     }
-    return false;
 }
 
-Value Interpreter::binaryOperation(const Value& left, TokenType op, const Value& right) {
-    switch (op) {
-        case TokenType::PLUS:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return valueToString(left) + valueToString(right);
-            } else if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-                return std::get<int>(left) + std::get<int>(right);
-            }
-            break;
-            
-        case TokenType::MINUS:
-            if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-                return std::get<int>(left) - std::get<int>(right);
-            }
-            break;
-            
-        case TokenType::EQUALS:
-            return (valueToString(left) == valueToString(right)) ? 1 : 0;
-            
-        case TokenType::NOT_EQUALS:
-            return (valueToString(left) != valueToString(right)) ? 1 : 0;
-            
-        case TokenType::LESS_THAN:
-            if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-                return (std::get<int>(left) < std::get<int>(right)) ? 1 : 0;
-            }
-            break;
-            
-        case TokenType::MULTIPLY:
-            if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-                return std::get<int>(left) * std::get<int>(right);
-            }
-            break;
-            
-        case TokenType::DIVIDE:
-            if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-                int rightVal = std::get<int>(right);
-                if (rightVal != 0) {
-                    return std::get<int>(left) / rightVal;
-                }
-            }
-            break;
-            
-        case TokenType::AND:
-            return (isTruthy(left) && isTruthy(right)) ? 1 : 0;
-            
-        case TokenType::OR:
-            return (isTruthy(left) || isTruthy(right)) ? 1 : 0;
+
+template <typename Hooks>
+void Interpreter<Hooks>::interpret(Program* program) {
+    variables.clear();
+    for (const auto& slot : program->slots) {
+        variables.push_back(defaultValue(slot.type, slot.arraySize));
+    }
+    if (jitEnabled) {
+        jit = std::make_unique<Jit>(program);
     }
     
-    return 0;
+    hooks.programStarted(*program, variables);
+    for (auto& stmt : program->statements) {
+        execute(stmt.get());
+    }
+    hooks.programFinished(variables);
 }
 
-void Interpreter::debugPrint(const std::string& message, int level) {
-    if (debugMode && debugLevel >= level) {
+template class Interpreter<NoHooks>;
+template class Interpreter<CountingHooks>;
+template class Interpreter<DebugHooks>;
+template class Interpreter<ProfileHooks>;
+template class Interpreter<TraceHooks>;
+
+void DebugHooks::print(const std::string& message, int minimumLevel) const {
+    if (level >= minimumLevel) {
         std::cout << "[DEBUG] " << message << std::endl;
     }
 }
 
-void Interpreter::debugPrintVariables() {
-    if (!debugMode || debugLevel < 2) return;
-    
+void DebugHooks::printVariables(const std::vector<Value>& variables) const {
     std::cout << "[DEBUG] Variables:\n";
     if (variables.empty()) {
         std::cout << "[DEBUG]   (none)\n";
     } else {
-        for (const auto& [name, value] : variables) {
-            std::cout << "[DEBUG]   " << name << " = " << valueToString(value) << "\n";
+        for (size_t i = 0; i < variables.size(); i++) {
+            std::cout << "[DEBUG]   " << (*slots)[i].name << " = " << valueToString(variables[i]) << "\n";
         }
     }
 }
 
-void Interpreter::debugPrintStatement(Statement* stmt) {
-    if (!debugMode || debugLevel < 1) return;
-    
-    std::cout << "[DEBUG] Executing statement #" << currentStatement << ": ";
-    
-    if (dynamic_cast<PrintStatement*>(stmt)) {
-        std::cout << "PRINT";
-    } else if (dynamic_cast<VarDeclaration*>(stmt)) {
-        auto decl = dynamic_cast<VarDeclaration*>(stmt);
-        std::cout << "VAR_DECLARATION (" << decl->name << " : " << decl->type << ")";
-    } else if (dynamic_cast<Assignment*>(stmt)) {
-        auto assign = dynamic_cast<Assignment*>(stmt);
-        std::cout << "ASSIGNMENT (" << assign->varName << ")";
-    } else if (dynamic_cast<ForLoop*>(stmt)) {
-        std::cout << "FOR_LOOP";
-    } else if (dynamic_cast<WhileLoop*>(stmt)) {
-        std::cout << "WHILE_LOOP";
-    } else if (dynamic_cast<IfStatement*>(stmt)) {
-        std::cout << "IF_STATEMENT";
-    } else if (dynamic_cast<IncrementStatement*>(stmt)) {
-        auto inc = dynamic_cast<IncrementStatement*>(stmt);
-        std::cout << "INCREMENT (" << inc->varName << " += " << inc->amount << ")";
-    } else if (dynamic_cast<ReadStatement*>(stmt)) {
-        auto read = dynamic_cast<ReadStatement*>(stmt);
-        std::cout << "READ (" << read->varName << ")";
-    } else {
-        std::cout << "UNKNOWN";
-    }
-    
-    std::cout << std::endl;
+void DebugHooks::programStarted(const Program& program, const std::vector<Value>&) {
+    slots = &program.slots;
+    depth = 0;
+    executed = 0;
+    print("Starting program execution", 1);
+    print("Total statements: " + std::to_string(program.statements.size()), 2);
 }
 
-void Interpreter::waitForStep() {
-    if (stepByStep) {
-        std::cout << "[DEBUG] Press Enter to continue...";
-        std::string dummy;
-        std::getline(std::cin, dummy);
+void DebugHooks::beforeStatement(const Statement* stmt, const std::vector<Value>& variables) {
+    executed++;
+    if (level >= 1) {
+        std::cout << "[DEBUG] " << std::string(depth * 2, ' ') << "Executing statement #" << executed
+                  << " (line " << stmt->line << "): ";
+        
+        if (dynamic_cast<const PrintStatement*>(stmt)) {
+            std::cout << "PRINT";
+        } else if (auto decl = dynamic_cast<const VarDeclaration*>(stmt)) {
+            std::cout << "VAR_DECLARATION (" << decl->name << " : " << decl->type << ")";
+        } else if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+            std::cout << "ASSIGNMENT (" << assign->varName << ")";
+        } else if (dynamic_cast<const ForLoop*>(stmt)) {
+            std::cout << "FOR_LOOP";
+        } else if (dynamic_cast<const WhileLoop*>(stmt)) {
+            std::cout << "WHILE_LOOP";
+        } else if (dynamic_cast<const IfStatement*>(stmt)) {
+            std::cout << "IF_STATEMENT";
+        } else if (auto inc = dynamic_cast<const IncrementStatement*>(stmt)) {
+            std::cout << "INCREMENT (" << inc->varName << " += " << inc->amount << ")";
+        } else if (auto read = dynamic_cast<const ReadStatement*>(stmt)) {
+            std::cout << "READ (" << read->varName << ")";
+        } else {
+            std::cout << "UNKNOWN";
+        }
+        std::cout << std::endl;
+    }
+    if (level >= 2) {
+        printVariables(variables);
     }
+    if (step) {
+        std::cout << "[DEBUG] Press Enter to continue..." << std::flush;
+        std::string_view dummy;
+        standardInput().readLine(dummy);
+    }
+    depth++;
 }
 
-void Interpreter::setDebugMode(bool enabled, int level, bool step) {
-    debugMode = enabled;
-    debugLevel = level;
-    stepByStep = step;
+void DebugHooks::afterStatement(const Statement*, const std::vector<Value>& variables) {
+    depth--;
+    if (level >= 3) {
+        std::cout << "[DEBUG] Statement completed\n";
+        printVariables(variables);
+    }
 }
 
-void Interpreter::interpret(Program* program) {
-    debugPrint("Starting program execution", 1);
-    debugPrint("Total statements: " + std::to_string(program->statements.size()), 2);
-    
-    currentStatement = 0;
-    for (auto& stmt : program->statements) {
-        currentStatement++;
-        
-        if (debugMode) {
-            debugPrintStatement(stmt.get());
-            if (debugLevel >= 2) {
-                debugPrintVariables();
-            }
-            waitForStep();
-        }
-        
-        execute(stmt.get());
-        
-        if (debugMode && debugLevel >= 3) {
-            std::cout << "[DEBUG] Statement completed\n";
-            debugPrintVariables();
-        }
-    }
-    
-    debugPrint("Program execution completed", 1);
-    if (debugLevel >= 2) {
+void DebugHooks::programFinished(const std::vector<Value>& variables) {
+    print("Program execution completed", 1);
+    if (level >= 2) {
         std::cout << "[DEBUG] Final state:\n";
-        debugPrintVariables();
+        printVariables(variables);
     }
-}
\ No newline at end of file
+}
@@ -1,31 +1,89 @@
 #pragma once
 #include "parser.h"
-#include <unordered_map>
-#include <variant>
+#include "value.h"
+#include "jit.h"
+#include <memory>
 #include <vector>
 
-using Value = std::variant<int, std::string, std::vector<std::string>>;
+// Hooks policies say what Interpreter<Hooks> reports as it runs. The
+// interpreter calls them at the start and end of the program, around
+// every statement it executes, at every nesting depth, and after each
+// write to a variable; `index` is the element index for a write to one
+// element of an array and nullptr otherwise. NoHooks is what run uses: its
+// members are empty and inline, so they compile away. Every other policy
+// counts the statements executed for --stats in getStatementsExecuted().
+struct NoHooks {
+    void programStarted(const Program&, const std::vector<Value>&) {}
+    void beforeStatement(const Statement*, const std::vector<Value>&) {}
+    void afterStatement(const Statement*, const std::vector<Value>&) {}
+    void variableWritten(const std::vector<Value>&, int, const Value*) {}
+    void programFinished(const std::vector<Value>&) {}
+};
 
+// What run uses under --stats: NoHooks plus the statement count. Loops run
+// by the JIT count as one statement.
+class CountingHooks {
+private:
+    uint64_t executed = 0;
+
+public:
+    void programStarted(const Program&, const std::vector<Value>&) { executed = 0; }
+    void beforeStatement(const Statement*, const std::vector<Value>&) { executed++; }
+    void afterStatement(const Statement*, const std::vector<Value>&) {}
+    void variableWritten(const std::vector<Value>&, int, const Value*) {}
+    void programFinished(const std::vector<Value>&) {}
+    uint64_t getStatementsExecuted() const { return executed; }
+};
+
+// Traces for `gov debug`. Level 1 shows each statement as it starts,
+// indented by its nesting depth; level 2 adds the variables before it and
+// level 3 after it too. With `step` it waits for Enter before each one.
+class DebugHooks {
+private:
+    int level;
+    bool step;
+    int depth = 0;
+    uint64_t executed = 0;
+    const std::vector<VariableSlot>* slots = nullptr;
+
+    void print(const std::string& message, int minimumLevel) const;
+    void printVariables(const std::vector<Value>& variables) const;
+
+public:
+    DebugHooks(int level, bool step) : level(level), step(step) {}
+
+    void programStarted(const Program& program, const std::vector<Value>& variables);
+    void beforeStatement(const Statement* stmt, const std::vector<Value>& variables);
+    void afterStatement(const Statement* stmt, const std::vector<Value>& variables);
+    void variableWritten(const std::vector<Value>&, int, const Value*) {}
+    void programFinished(const std::vector<Value>& variables);
+    uint64_t getStatementsExecuted() const { return executed; }
+};
+
+// The tree-walking interpreter. It is instantiated in interpreter.cpp for
+// NoHooks, CountingHooks, DebugHooks, ProfileHooks (profiler.h) and
+// TraceHooks (trace.h).
+template <typename Hooks>
 class Interpreter {
 private:
-    std::unordered_map<std::string, Value> variables;
-    bool debugMode = false;
-    int debugLevel = 0;
-    bool stepByStep = false;
-    int currentStatement = 0;
-    
+    std::vector<Value> variables; // indexed by Resolver slot
+    bool jitEnabled = false;
+    std::unique_ptr<Jit> jit;
+    Hooks hooks;
+
     Value evaluate(Expression* expr);
+    const Value& evaluateRef(Expression* expr, Value& scratch);
+    const Value* elementRef(ArrayAccess* access);
+    bool evaluateCondition(Expression* expr);
     void execute(Statement* stmt);
-    std::string valueToString(const Value& val);
-    bool isTruthy(const Value& val);
+    void executeStatement(Statement* stmt);
     Value binaryOperation(const Value& left, TokenType op, const Value& right);
-    
-    void debugPrint(const std::string& message, int level = 1);
-    void debugPrintVariables();
-    void debugPrintStatement(Statement* stmt);
-    void waitForStep();
-    
+    static int integerOperation(int left, TokenType op, int right);
+
 public:
+    explicit Interpreter(Hooks hooks = Hooks()) : hooks(std::move(hooks)) {}
+
     void interpret(Program* program);
-    void setDebugMode(bool enabled, int level = 1, bool step = false);
-};
\ No newline at end of file
+    void setJitEnabled(bool enabled) { jitEnabled = enabled; }
+    const Hooks& getHooks() const { return hooks; }
+};
@@ -0,0 +1,495 @@
+#include "jit.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(_WIN32)
+#define GOV_JIT_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef GOV_JIT_X64
+
+namespace {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Condition codes for jcc/setcc
+enum Condition : uint8_t { EQUAL = 0x4, NOT_EQUAL = 0x5, LESS = 0xC };
+
+// Loop variables live in these registers. rax and rcx are the expression
+// scratch pair, rdx is clobbered by idiv and rdi holds the value array.
+const Reg variableRegisters[] = {RBX, RBP, RSI, R8, R9, R10, R11, R12, R13, R14, R15};
+const Reg calleeSaved[] = {RBX, RBP, R12, R13, R14, R15};
+
+// Just enough of an x86-64 encoder for 32-bit integer code
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    size_t here() const { return code.size(); }
+
+    void byte(uint8_t b) { code.push_back(b); }
+
+    void imm32(int32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        code.insert(code.end(), bytes, bytes + 4);
+    }
+
+    // REX prefix, only needed when r8-r15 appear in the reg or rm field
+    void rex(uint8_t reg, uint8_t rm) {
+        uint8_t prefix = 0x40 | ((reg & 8) ? 0x4 : 0) | ((rm & 8) ? 0x1 : 0);
+        if (prefix != 0x40) byte(prefix);
+    }
+
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        byte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    // <op> dst, src for the "r/m32, r32" opcodes (mov, add, sub, cmp, test...)
+    void alu(uint8_t opcode, Reg dst, Reg src) {
+        rex(src, dst);
+        byte(opcode);
+        modrm(3, src, dst);
+    }
+
+    void mov(Reg dst, Reg src) {
+        if (dst != src) alu(0x89, dst, src);
+    }
+
+    void movImm(Reg dst, int32_t value) {
+        if (dst & 8) byte(0x41);
+        byte(0xB8 + (dst & 7));
+        imm32(value);
+    }
+
+    void addImm(Reg dst, int32_t value) {
+        rex(0, dst);
+        byte(0x81);
+        modrm(3, 0, dst);
+        imm32(value);
+    }
+
+    void cmpImm(Reg dst, int32_t value) {
+        rex(0, dst);
+        byte(0x81);
+        modrm(3, 7, dst);
+        imm32(value);
+    }
+
+    void imul(Reg dst, Reg src) {
+        rex(dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrm(3, dst, src);
+    }
+
+    // dst = [rdi + offset]
+    void load(Reg dst, int32_t offset) {
+        rex(dst, RDI);
+        byte(0x8B);
+        modrm(2, dst, RDI);
+        imm32(offset);
+    }
+
+    // [rdi + offset] = src
+    void store(int32_t offset, Reg src) {
+        rex(src, RDI);
+        byte(0x89);
+        modrm(2, src, RDI);
+        imm32(offset);
+    }
+
+    void push(Reg reg) {
+        if (reg & 8) byte(0x41);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(Reg reg) {
+        if (reg & 8) byte(0x41);
+        byte(0x58 + (reg & 7));
+    }
+
+    // al or cl = condition
+    void setcc(Condition condition, Reg lowByte) {
+        byte(0x0F);
+        byte(0x90 | condition);
+        modrm(3, 0, lowByte);
+    }
+
+    // eax = zero-extended al
+    void movzxAl() {
+        byte(0x0F);
+        byte(0xB6);
+        byte(0xC0);
+    }
+
+    // Forward jumps return the position of their rel32 field for patch()
+    size_t jmp() {
+        byte(0xE9);
+        imm32(0);
+        return here() - 4;
+    }
+
+    size_t jcc(Condition condition) {
+        byte(0x0F);
+        byte(0x80 | condition);
+        imm32(0);
+        return here() - 4;
+    }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(target - (at + 4));
+        std::memcpy(&code[at], &rel, 4);
+    }
+
+    void jmpBack(size_t target) {
+        byte(0xE9);
+        imm32(static_cast<int32_t>(target - (here() + 4)));
+    }
+
+    void ret() { byte(0xC3); }
+};
+
+class LoopCompiler {
+private:
+    const std::vector<VariableSlot>& slots;
+    std::vector<int> used; // slot of each variable register, in order
+    std::unordered_map<int, Reg> registers;
+    Assembler as;
+
+    bool use(int slot);
+    bool supports(Expression* expr);
+    bool supports(Statement* stmt);
+    bool supports(const NodeList<Statement>& block);
+
+    void emitExpression(Expression* expr);
+    void emitOperator(TokenType op);
+    void emitStatement(Statement* stmt);
+    void emitBlock(const NodeList<Statement>& block);
+    void emitLoop(Expression* condition, const NodeList<Statement>& body);
+
+public:
+    explicit LoopCompiler(const std::vector<VariableSlot>& slots) : slots(slots) {}
+
+    std::unique_ptr<JitLoop> compile(Statement* loop);
+};
+
+// Assigns a register to an integer variable; fails for anything that may
+// hold a string or an array, or once the registers run out
+bool LoopCompiler::use(int slot) {
+    if (slot < 0 || static_cast<size_t>(slot) >= slots.size() || !slots[slot].integerOnly) {
+        return false;
+    }
+    if (registers.count(slot)) {
+        return true;
+    }
+    if (used.size() == sizeof(variableRegisters) / sizeof(variableRegisters[0])) {
+        return false;
+    }
+    registers[slot] = variableRegisters[used.size()];
+    used.push_back(slot);
+    return true;
+}
+
+bool LoopCompiler::supports(Expression* expr) {
+    if (dynamic_cast<IntegerLiteral*>(expr)) {
+        return true;
+    }
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        return use(id->slot);
+    }
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        switch (binOp->op) {
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+            case TokenType::MULTIPLY:
+            case TokenType::DIVIDE:
+            case TokenType::LESS_THAN:
+            case TokenType::EQUALS:
+            case TokenType::NOT_EQUALS:
+            case TokenType::AND:
+            case TokenType::OR:
+                break;
+            default:
+                return false;
+        }
+        return binOp->operands == OperandTypes::INT_INT &&
+               supports(binOp->left.get()) && supports(binOp->right.get());
+    }
+    return false;
+}
+
+bool LoopCompiler::supports(Statement* stmt) {
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        return !assign->index && use(assign->slot) && supports(assign->value.get());
+    }
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        return use(inc->slot);
+    }
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        return decl->type == "INTEGER" && use(decl->slot);
+    }
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        return supports(forLoop->condition.get()) && supports(forLoop->body);
+    }
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        return supports(whileLoop->condition.get()) && supports(whileLoop->body);
+    }
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        if (!supports(ifStmt->condition.get()) || !supports(ifStmt->thenBranch)) {
+            return false;
+        }
+        for (auto& clause : ifStmt->elseIfClauses) {
+            if (!supports(clause.condition.get()) || !supports(clause.body)) {
+                return false;
+            }
+        }
+        return supports(ifStmt->elseBranch);
+    }
+    return false;
+}
+
+bool LoopCompiler::supports(const NodeList<Statement>& block) {
+    for (auto& stmt : block) {
+        if (!supports(stmt.get())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Leaves the value of `expr` in eax. A literal or variable right operand
+// goes straight to ecx; anything else is evaluated first and saved on the
+// machine stack.
+void LoopCompiler::emitExpression(Expression* expr) {
+    if (auto literal = dynamic_cast<IntegerLiteral*>(expr)) {
+        as.movImm(RAX, literal->value);
+        return;
+    }
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        as.mov(RAX, registers[id->slot]);
+        return;
+    }
+
+    auto binOp = static_cast<BinaryOp*>(expr);
+    Expression* right = binOp->right.get();
+    if (auto literal = dynamic_cast<IntegerLiteral*>(right)) {
+        emitExpression(binOp->left.get());
+        as.movImm(RCX, literal->value);
+    } else if (auto id = dynamic_cast<Identifier*>(right)) {
+        emitExpression(binOp->left.get());
+        as.mov(RCX, registers[id->slot]);
+    } else {
+        emitExpression(right);
+        as.push(RAX);
+        emitExpression(binOp->left.get());
+        as.pop(RCX);
+    }
+    emitOperator(binOp->op);
+}
+
+// eax = eax <op> ecx, with the same results as integerOperation()
+void LoopCompiler::emitOperator(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS:
+            as.alu(0x01, RAX, RCX);
+            break;
+        case TokenType::MINUS:
+            as.alu(0x29, RAX, RCX);
+            break;
+        case TokenType::MULTIPLY:
+            as.imul(RAX, RCX);
+            break;
+        case TokenType::DIVIDE: {
+            // x / 0 is 0; x / -1 is negated so INT_MIN cannot trap in idiv
+            as.alu(0x85, RCX, RCX);
+            size_t byZero = as.jcc(EQUAL);
+            as.cmpImm(RCX, -1);
+            size_t divide = as.jcc(NOT_EQUAL);
+            as.byte(0xF7);
+            as.modrm(3, 3, RAX); // neg eax
+            size_t negated = as.jmp();
+            as.patch(divide, as.here());
+            as.byte(0x99); // cdq
+            as.byte(0xF7);
+            as.modrm(3, 7, RCX); // idiv ecx
+            size_t divided = as.jmp();
+            as.patch(byZero, as.here());
+            as.alu(0x31, RAX, RAX);
+            as.patch(negated, as.here());
+            as.patch(divided, as.here());
+            break;
+        }
+        case TokenType::LESS_THAN:
+        case TokenType::EQUALS:
+        case TokenType::NOT_EQUALS:
+            as.alu(0x39, RAX, RCX);
+            as.setcc(op == TokenType::LESS_THAN ? LESS : op == TokenType::EQUALS ? EQUAL : NOT_EQUAL, RAX);
+            as.movzxAl();
+            break;
+        case TokenType::AND:
+        case TokenType::OR:
+            as.alu(0x85, RAX, RAX);
+            as.setcc(NOT_EQUAL, RAX);
+            as.alu(0x85, RCX, RCX);
+            as.setcc(NOT_EQUAL, RCX);
+            as.byte(op == TokenType::AND ? 0x20 : 0x08); // and/or al, cl
+            as.modrm(3, RCX, RAX);
+            as.movzxAl();
+            break;
+        default:
+            break;
+    }
+}
+
+void LoopCompiler::emitStatement(Statement* stmt) {
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        emitExpression(assign->value.get());
+        as.mov(registers[assign->slot], RAX);
+        return;
+    }
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        as.addImm(registers[inc->slot], inc->amount);
+        return;
+    }
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        as.movImm(registers[decl->slot], 0);
+        return;
+    }
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        emitLoop(forLoop->condition.get(), forLoop->body);
+        return;
+    }
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        emitLoop(whileLoop->condition.get(), whileLoop->body);
+        return;
+    }
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        std::vector<size_t> toEnd;
+        emitExpression(ifStmt->condition.get());
+        as.alu(0x85, RAX, RAX);
+        size_t next = as.jcc(EQUAL);
+        emitBlock(ifStmt->thenBranch);
+        toEnd.push_back(as.jmp());
+        for (auto& clause : ifStmt->elseIfClauses) {
+            as.patch(next, as.here());
+            emitExpression(clause.condition.get());
+            as.alu(0x85, RAX, RAX);
+            next = as.jcc(EQUAL);
+            emitBlock(clause.body);
+            toEnd.push_back(as.jmp());
+        }
+        as.patch(next, as.here());
+        emitBlock(ifStmt->elseBranch);
+        for (size_t jump : toEnd) {
+            as.patch(jump, as.here());
+        }
+        return;
+    }
+}
+
+void LoopCompiler::emitBlock(const NodeList<Statement>& block) {
+    for (auto& stmt : block) {
+        emitStatement(stmt.get());
+    }
+}
+
+void LoopCompiler::emitLoop(Expression* condition, const NodeList<Statement>& body) {
+    size_t top = as.here();
+    emitExpression(condition);
+    as.alu(0x85, RAX, RAX);
+    size_t exit = as.jcc(EQUAL);
+    emitBlock(body);
+    as.jmpBack(top);
+    as.patch(exit, as.here());
+}
+
+std::unique_ptr<JitLoop> LoopCompiler::compile(Statement* loop) {
+    if (!supports(loop)) {
+        return nullptr;
+    }
+
+    for (Reg reg : calleeSaved) {
+        as.push(reg);
+    }
+    for (size_t i = 0; i < used.size(); ++i) {
+        as.load(registers[used[i]], static_cast<int32_t>(i * 4));
+    }
+    emitStatement(loop);
+    for (size_t i = 0; i < used.size(); ++i) {
+        as.store(static_cast<int32_t>(i * 4), registers[used[i]]);
+    }
+    for (size_t i = sizeof(calleeSaved) / sizeof(calleeSaved[0]); i-- > 0;) {
+        as.pop(calleeSaved[i]);
+    }
+    as.ret();
+
+    // Written while the pages are writable, then switched to executable
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (as.code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, as.code.data(), as.code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+
+    auto native = std::make_unique<JitLoop>();
+    native->slots = used;
+    native->memory = memory;
+    native->memorySize = size;
+    native->entry = reinterpret_cast<void (*)(int32_t*)>(memory);
+    return native;
+}
+
+} // namespace
+
+JitLoop::~JitLoop() {
+    if (memory) {
+        munmap(memory, memorySize);
+    }
+}
+
+void JitLoop::run(std::vector<Value>& variables) const {
+    int32_t values[sizeof(variableRegisters) / sizeof(variableRegisters[0])];
+    for (size_t i = 0; i < slots.size(); ++i) {
+        values[i] = variables[slots[i]].asInt();
+    }
+    entry(values);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        variables[slots[i]] = values[i];
+    }
+}
+
+JitLoop* Jit::loopFor(Statement* loop) {
+    auto it = cache.find(loop);
+    if (it == cache.end()) {
+        LoopCompiler compiler(*slots);
+        it = cache.emplace(loop, compiler.compile(loop)).first;
+    }
+    return it->second.get();
+}
+
+bool Jit::available() {
+    return true;
+}
+
+#else
+
+JitLoop::~JitLoop() {}
+
+void JitLoop::run(std::vector<Value>&) const {}
+
+JitLoop* Jit::loopFor(Statement*) {
+    return nullptr;
+}
+
+bool Jit::available() {
+    return false;
+}
+
+#endif
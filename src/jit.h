@@ -0,0 +1,43 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Native code for one FOR_THE_PEOPLE or WHILE loop. The loop's variables
+// are passed in as an int32 array (in `slots` order), live in registers
+// while the loop runs and are written back to the array when it exits.
+struct JitLoop {
+    std::vector<int> slots;
+    void (*entry)(int32_t* values) = nullptr;
+    void* memory = nullptr;
+    size_t memorySize = 0;
+
+    ~JitLoop();
+
+    // Runs the loop against an engine's variable frame
+    void run(std::vector<Value>& variables) const;
+};
+
+// Baseline x86-64 JIT (--jit). A loop qualifies when its condition and
+// body only involve variables the TypeChecker proved to be integers:
+// SET, INCREMENT, INTEGER declarations, IF and nested loops over
+// + - * / LESS_THAN EQUALS NOT_EQUALS AND OR. Anything else (strings,
+// arrays, PRAISE_LEADER, READ) keeps the loop in the interpreter.
+class Jit {
+private:
+    const std::vector<VariableSlot>* slots;
+    // nullptr entries remember loops that cannot be compiled
+    std::unordered_map<Statement*, std::unique_ptr<JitLoop>> cache;
+
+public:
+    explicit Jit(const Program* program) : slots(&program->slots) {}
+
+    // Compiled code for `loop`, or nullptr when it must be interpreted
+    JitLoop* loopFor(Statement* loop);
+
+    // False on hosts where no native code can be generated
+    static bool available();
+};
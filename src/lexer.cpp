@@ -1,47 +1,103 @@
 #include "lexer.h"
 #include <iostream>
 
-Lexer::Lexer(const std::string& source) : source(source), current(0), line(1), column(1) {
-    initKeywords();
-}
-
-void Lexer::initKeywords() {
-    keywords["!I_LOVE_GOVERNMENT"] = TokenType::I_LOVE_GOVERNMENT;
-    keywords["PRAISE_LEADER"] = TokenType::PRAISE_LEADER;
-    keywords["OBEY_PARTY_LINE"] = TokenType::OBEY_PARTY_LINE;
-    keywords["PLEASE"] = TokenType::PLEASE;
-    keywords["DECLARE_VARIABLE"] = TokenType::DECLARE_VARIABLE;
-    keywords["AS"] = TokenType::AS;
-    keywords["INTEGER"] = TokenType::INTEGER_TYPE;
-    keywords["STRING"] = TokenType::STRING_TYPE;
-    keywords["ARRAY_OF_STRING"] = TokenType::ARRAY_OF_STRING;
-    keywords["SIZE"] = TokenType::SIZE;
-    keywords["SET"] = TokenType::SET;
-    keywords["TO"] = TokenType::TO;
-    keywords["FOR_THE_PEOPLE"] = TokenType::FOR_THE_PEOPLE;
-    keywords["LESS_THAN"] = TokenType::LESS_THAN;
-    keywords["DO"] = TokenType::DO;
-    keywords["END_FOR_THE_PEOPLE"] = TokenType::END_FOR_THE_PEOPLE;
-    keywords["INCREMENT"] = TokenType::INCREMENT;
-    keywords["BY"] = TokenType::BY;
-    keywords["DENOUNCE_IMPERIALIST_ERRORS"] = TokenType::DENOUNCE_IMPERIALIST_ERRORS;
-    keywords["WHILE"] = TokenType::WHILE;
-    keywords["EQUALS"] = TokenType::EQUALS;
-    keywords["AND"] = TokenType::AND;
-    keywords["OR"] = TokenType::OR;
-    keywords["NOT_EQUALS"] = TokenType::NOT_EQUALS;
-    keywords["IF"] = TokenType::IF;
-    keywords["THEN"] = TokenType::THEN;
-    keywords["ELSE"] = TokenType::ELSE;
-    keywords["ELSE_IF"] = TokenType::ELSE_IF;
-    keywords["END_IF"] = TokenType::END_IF;
-    keywords["END_WHILE"] = TokenType::END_WHILE;
-    keywords["READ"] = TokenType::READ;
+namespace {
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"!I_LOVE_GOVERNMENT", TokenType::I_LOVE_GOVERNMENT},
+    {"PRAISE_LEADER", TokenType::PRAISE_LEADER},
+    {"OBEY_PARTY_LINE", TokenType::OBEY_PARTY_LINE},
+    {"PLEASE", TokenType::PLEASE},
+    {"DECLARE_VARIABLE", TokenType::DECLARE_VARIABLE},
+    {"AS", TokenType::AS},
+    {"INTEGER", TokenType::INTEGER_TYPE},
+    {"STRING", TokenType::STRING_TYPE},
+    {"ARRAY_OF_STRING", TokenType::ARRAY_OF_STRING},
+    {"SIZE", TokenType::SIZE},
+    {"SET", TokenType::SET},
+    {"TO", TokenType::TO},
+    {"FOR_THE_PEOPLE", TokenType::FOR_THE_PEOPLE},
+    {"LESS_THAN", TokenType::LESS_THAN},
+    {"DO", TokenType::DO},
+    {"END_FOR_THE_PEOPLE", TokenType::END_FOR_THE_PEOPLE},
+    {"INCREMENT", TokenType::INCREMENT},
+    {"BY", TokenType::BY},
+    {"DENOUNCE_IMPERIALIST_ERRORS", TokenType::DENOUNCE_IMPERIALIST_ERRORS},
+    {"WHILE", TokenType::WHILE},
+    {"EQUALS", TokenType::EQUALS},
+    {"AND", TokenType::AND},
+    {"OR", TokenType::OR},
+    {"NOT_EQUALS", TokenType::NOT_EQUALS},
+    {"IF", TokenType::IF},
+    {"THEN", TokenType::THEN},
+    {"ELSE", TokenType::ELSE},
+    {"ELSE_IF", TokenType::ELSE_IF},
+    {"END_IF", TokenType::END_IF},
+    {"END_WHILE", TokenType::END_WHILE},
+    {"READ", TokenType::READ},
+};
+
+constexpr size_t KEYWORD_TABLE_SIZE = 128;
+constexpr uint8_t NO_KEYWORD = 0xFF;
+
+// Perfect hash over KEYWORDS: the length plus weighted first and last
+// characters. The weights were searched for offline; the static_assert
+// below rejects any keyword set they do not separate.
+constexpr size_t keywordHash(std::string_view word) {
+    return (word.size() + 2 * static_cast<unsigned char>(word.front()) +
+            5 * static_cast<unsigned char>(word.back())) % KEYWORD_TABLE_SIZE;
+}
+
+struct KeywordTable {
+    uint8_t index[KEYWORD_TABLE_SIZE]; // hash -> KEYWORDS entry or NO_KEYWORD
+    bool perfect;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table{};
+    for (auto& entry : table.index) {
+        entry = NO_KEYWORD;
+    }
+    table.perfect = true;
+    for (size_t i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); ++i) {
+        size_t hash = keywordHash(KEYWORDS[i].text);
+        if (table.index[hash] != NO_KEYWORD) {
+            table.perfect = false;
+        }
+        table.index[hash] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+static_assert(KEYWORD_TABLE.perfect, "keyword hash collides; choose new weights for keywordHash");
+
+// One table probe and at most one comparison per word
+TokenType keywordType(std::string_view word) {
+    uint8_t index = KEYWORD_TABLE.index[keywordHash(word)];
+    if (index != NO_KEYWORD && KEYWORDS[index].text == word) {
+        return KEYWORDS[index].type;
+    }
+    return TokenType::IDENTIFIER;
 }
 
+} // namespace
+
+Lexer::Lexer(std::string_view source, bool reportErrors)
+    : source(source), scan(scanners()), current(0), line(1), lineStart(0), startLine(1), startColumn(1),
+      reportErrors(reportErrors) {}
+
+Lexer::Lexer(std::string_view source, size_t start, int line, bool reportErrors)
+    : source(source), scan(scanners()), current(start), line(line), lineStart(start), startLine(line),
+      startColumn(1), reportErrors(reportErrors) {}
+
 char Lexer::advance() {
     if (isAtEnd()) return '\0';
-    column++;
     return source[current++];
 }
 
@@ -71,128 +127,170 @@ bool Lexer::isAlphaNumeric(char c) {
     return isAlpha(c) || isDigit(c);
 }
 
-Token Lexer::makeToken(TokenType type, const std::string& value) {
-    return {type, value, line, column};
+// Records the '\n' at `offset`
+void Lexer::newline(size_t offset) {
+    line++;
+    lineStart = offset + 1;
+}
+
+// Columns are derived from the start of the line rather than counted per
+// character, so only newlines need tracking while scanning
+int Lexer::columnOf(size_t offset) const {
+    return static_cast<int>(offset - lineStart) + 1;
+}
+
+// The token's text is source[start, end)
+Token Lexer::makeToken(TokenType type, size_t start, size_t end) {
+    return {type, static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), startLine, startColumn};
 }
 
 Token Lexer::string() {
-    std::string value = "";
+    size_t start = current;
+    size_t end = source.length();
+    bool validUtf8 = true;
     
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') {
-            line++;
-            column = 0;
+    while (true) {
+        current = scan.findStringStop(source.data(), current, end);
+        if (current >= end) break;
+        
+        unsigned char c = static_cast<unsigned char>(source[current]);
+        if (c == '"') break;
+        if (c == '\n') {
+            newline(current);
+            current++;
+            continue;
+        }
+        
+        // Non-ASCII: validate the whole sequence while we are here
+        size_t length = utf8SequenceLength(reinterpret_cast<const unsigned char*>(source.data()) + current,
+                                           end - current);
+        if (length == 0) {
+            // One report per literal; the bytes are kept as they are
+            if (validUtf8) {
+                errors++;
+                if (reportErrors) {
+                    std::cerr << "Invalid UTF-8 in string at line " << line << ", column " << columnOf(current)
+                              << std::endl;
+                }
+            }
+            validUtf8 = false;
+            length = 1;
         }
-        value += advance();
+        current += length;
     }
     
     if (isAtEnd()) {
-        std::cerr << "Unterminated string at line " << line << std::endl;
+        errors++;
+        unterminated = true;
+        if (reportErrors) {
+            std::cerr << "Unterminated string at line " << line << std::endl;
+        }
         return makeToken(TokenType::EOF_TOKEN);
     }
     
+    end = current;
     advance(); // closing quote
-    return makeToken(TokenType::STRING, value);
+    return makeToken(TokenType::STRING, start, end);
 }
 
 Token Lexer::number() {
-    std::string value = "";
+    size_t start = current;
     
     while (isDigit(peek())) {
-        value += advance();
+        advance();
     }
     
-    return makeToken(TokenType::INTEGER, value);
+    return makeToken(TokenType::INTEGER, start, current);
 }
 
 Token Lexer::identifier() {
-    std::string value = "";
+    size_t start = current;
     
     while (isAlphaNumeric(peek())) {
-        value += advance();
-    }
-    
-    auto it = keywords.find(value);
-    if (it != keywords.end()) {
-        return makeToken(it->second, value);
+        advance();
     }
     
-    return makeToken(TokenType::IDENTIFIER, value);
+    return makeToken(keywordType(source.substr(start, current - start)), start, current);
 }
 
 void Lexer::skipWhitespace() {
+    size_t end = source.length();
     while (true) {
         char c = peek();
         if (c == ' ' || c == '\r' || c == '\t') {
+            // Most gaps are one space, so only longer runs go to the scanner
             advance();
+            c = peek();
+            if (c == ' ' || c == '\r' || c == '\t') {
+                current = scan.skipBlanks(source.data(), current, end);
+            }
         } else if (c == '/' && peekNext() == '/') {
-            // Skip comment
-            while (peek() != '\n' && !isAtEnd()) advance();
+            // Skip comment, leaving the newline for next()
+            current = scan.findNewline(source.data(), current + 2, end);
         } else {
             break;
         }
     }
 }
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    
-    while (!isAtEnd()) {
+Token Lexer::next() {
+    while (true) {
         skipWhitespace();
         
-        if (isAtEnd()) break;
+        if (isAtEnd()) {
+            finished = true;
+            startLine = line;
+            startColumn = columnOf(current);
+            return makeToken(TokenType::EOF_TOKEN);
+        }
         
+        startLine = line;
+        startColumn = columnOf(current);
         char c = advance();
         
         switch (c) {
             case '\n':
-                line++;
-                column = 1;
-                tokens.push_back(makeToken(TokenType::NEWLINE));
-                break;
+                newline(current - 1);
+                return makeToken(TokenType::NEWLINE);
             case '"':
-                tokens.push_back(string());
-                break;
+                return string();
             case '[':
-                tokens.push_back(makeToken(TokenType::LEFT_BRACKET));
-                break;
+                return makeToken(TokenType::LEFT_BRACKET);
             case ']':
-                tokens.push_back(makeToken(TokenType::RIGHT_BRACKET));
-                break;
+                return makeToken(TokenType::RIGHT_BRACKET);
             case '(':
-                tokens.push_back(makeToken(TokenType::LEFT_PAREN));
-                break;
+                return makeToken(TokenType::LEFT_PAREN);
             case ')':
-                tokens.push_back(makeToken(TokenType::RIGHT_PAREN));
-                break;
+                return makeToken(TokenType::RIGHT_PAREN);
             case '+':
-                tokens.push_back(makeToken(TokenType::PLUS));
-                break;
+                return makeToken(TokenType::PLUS);
             case '-':
-                tokens.push_back(makeToken(TokenType::MINUS));
-                break;
+                return makeToken(TokenType::MINUS);
             case '*':
-                tokens.push_back(makeToken(TokenType::MULTIPLY));
-                break;
+                return makeToken(TokenType::MULTIPLY);
             case '/':
-                tokens.push_back(makeToken(TokenType::DIVIDE));
-                break;
+                return makeToken(TokenType::DIVIDE);
             default:
                 if (isDigit(c)) {
                     current--; // Back up
-                    column--;
-                    tokens.push_back(number());
+                    return number();
                 } else if (isAlpha(c)) {
                     current--; // Back up
-                    column--;
-                    tokens.push_back(identifier());
-                } else {
+                    return identifier();
+                }
+                errors++;
+                if (reportErrors) {
                     std::cerr << "Unexpected character '" << c << "' at line " << line << std::endl;
                 }
                 break;
         }
     }
-    
-    tokens.push_back(makeToken(TokenType::EOF_TOKEN));
+}
+
+std::vector<Token> Lexer::tokenize() {
+    std::vector<Token> tokens;
+    while (!finished) {
+        tokens.push_back(next());
+    }
     return tokens;
 }
\ No newline at end of file
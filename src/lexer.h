@@ -1,7 +1,9 @@
 #pragma once
+#include "scan.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 enum class TokenType {
     // Literals
@@ -61,22 +63,32 @@ enum class TokenType {
     COMMENT
 };
 
+// A token is a plain record pointing into the source text, so lexing and
+// parsing copy no characters. For STRING tokens the span excludes the quotes.
 struct Token {
     TokenType type;
-    std::string value;
+    uint32_t offset;
+    uint32_t length;
     int line;
     int column;
+
+    std::string_view text(std::string_view source) const { return source.substr(offset, length); }
 };
 
 class Lexer {
 private:
-    std::string source;
+    std::string_view source; // must outlive the lexer and its tokens
+    const Scanners& scan;
     size_t current;
     int line;
-    int column;
-    std::unordered_map<std::string, TokenType> keywords;
+    size_t lineStart;  // offset of the first byte on the current line
+    int startLine;
+    int startColumn;
+    bool finished = false; // the final EOF_TOKEN has been returned
+    bool reportErrors;
+    int errors = 0;
+    bool unterminated = false; // the source ended inside a string literal
     
-    void initKeywords();
     char advance();
     char peek();
     char peekNext();
@@ -84,13 +96,33 @@ private:
     bool isAlpha(char c);
     bool isDigit(char c);
     bool isAlphaNumeric(char c);
-    Token makeToken(TokenType type, const std::string& value = "");
+    void newline(size_t offset);
+    int columnOf(size_t offset) const;
+    Token makeToken(TokenType type, size_t start = 0, size_t end = 0);
     Token string();
     Token number();
     Token identifier();
     void skipWhitespace();
     
 public:
-    Lexer(const std::string& source);
+    // Token offsets and lengths are 32-bit, and the EOF token sits at the
+    // end of the source, so longer sources must be refused before lexing
+    static constexpr size_t MAX_SOURCE_SIZE = UINT32_MAX - 1;
+
+    // A lexer with reportErrors false stays silent, for a second pass over
+    // source that another lexer already diagnoses
+    Lexer(std::string_view source, bool reportErrors = true);
+    // Lexes source from offset `start`, which must begin a line, numbering
+    // that line `line`. Token offsets still index the whole of `source`.
+    Lexer(std::string_view source, size_t start, int line, bool reportErrors);
+    
+    // Scans and returns the next token. At the end of the source it keeps
+    // returning EOF_TOKEN.
+    Token next();
+    // All remaining tokens, ending with EOF_TOKEN
     std::vector<Token> tokenize();
+    std::string_view getSource() const { return source; }
+    // Diagnostics found so far, whether or not they were printed
+    int errorCount() const { return errors; }
+    bool endsInString() const { return unterminated; }
 };
\ No newline at end of file
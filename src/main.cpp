@@ -1,48 +1,99 @@
 #include "lexer.h"
 #include "parser.h"
+#include "frontend.h"
+#include "resolver.h"
+#include "typechecker.h"
+#include "optimizer.h"
 #include "interpreter.h"
+#include "compiler.h"
+#include "vm.h"
+#include "closure.h"
+#include "jit.h"
+#include "codegen.h"
+#include "cache.h"
+#include "stats.h"
+#include "profiler.h"
+#include "trace.h"
+#include "source.h"
+#include "output.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <optional>
+#include <type_traits>
 
 struct Config {
     std::string command = "run";
     std::string filename;
     int debugLevel = 0;
     bool stepByStep = false;
+    std::string engine = "tree";
+    int optimizationLevel = -1; // -1: command default (1 for run, 0 otherwise)
+    std::string flush;          // empty: line on a terminal, full otherwise
+    bool jit = false;
+    std::string outputPath;     // compile: executable, or C++ source when it ends in .cpp;
+                                // profile: folded stacks; trace: binary trace;
+                                // trace-export: JSON
+    unsigned threads = 0;       // front end threads for large sources, 0: one per core
+    bool cache = true;          // reuse checked programs across runs
+    bool stats = false;         // JSON timings and counters on stderr
 };
 
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << filename << std::endl;
-        return "";
-    }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
 void printHelp(const std::string& programName) {
     std::cout << "Gov Language Interpreter\n\n";
     std::cout << "Usage: " << programName << " [COMMAND] [OPTIONS] <filename.gov>\n\n";
     std::cout << "Commands:\n";
     std::cout << "  run       Interpret and execute the code (default)\n";
     std::cout << "  parse     Show the parsed AST structure\n";
-    std::cout << "  debug     Show detailed runtime information\n\n";
+    std::cout << "  debug     Show detailed runtime information\n";
+    std::cout << "  compile   Translate to C++ and build a native executable (-o NAME)\n";
+    std::cout << "  profile   Run, then report the hottest lines and write folded stacks (-o NAME)\n";
+    std::cout << "  trace     Run, recording statements and variable writes in a binary trace (-o NAME)\n";
+    std::cout << "  trace-export  Convert a trace to Chrome trace / Perfetto JSON (-o NAME)\n\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help           Show this help message\n";
     std::cout << "  -v, --verbose LEVEL  Set debug verbosity level (0-3, default: 1 for debug, 0 for run)\n";
-    std::cout << "  -s, --step           Enable step-by-step execution in debug mode\n\n";
+    std::cout << "  -s, --step           Enable step-by-step execution in debug mode\n";
+    std::cout << "  --engine=NAME        Execution engine: tree (default), vm (bytecode) or closure\n";
+    std::cout << "  -O0, -O1             Disable/enable constant folding (default: -O1 for run)\n";
+    std::cout << "  --optimized          Same as -O1; shows the optimized tree with parse\n";
+    std::cout << "  --jit                Compile integer-only loops to native code (tree and closure engines)\n";
+    std::cout << "  --flush=POLICY       Output flushing: line, full or never-until-exit\n";
+    std::cout << "                       (default: line on a terminal, full otherwise)\n";
+    std::cout << "  --threads=N          Threads for parsing large sources (default: one per core)\n";
+    std::cout << "  --no-cache           Always build the program from source instead of reusing\n";
+    std::cout << "                       the copy cached in ~/.cache/gov by run and compile\n";
+    std::cout << "  --stats              Write phase timings, heap use and counts to stderr as JSON\n";
+    std::cout << "  -o NAME              Output of compile, profile, trace or trace-export (default:\n";
+    std::cout << "                       the input name without .gov, or with .folded, .govtrace or\n";
+    std::cout << "                       .json in place of its extension); a compile output ending\n";
+    std::cout << "                       in .cpp only writes the generated C++\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << programName << " hello_world.gov\n";
     std::cout << "  " << programName << " run hello_world.gov\n";
     std::cout << "  " << programName << " parse hello_world.gov\n";
     std::cout << "  " << programName << " debug -v 2 -s hello_world.gov\n";
+    std::cout << "  " << programName << " run --engine=vm hello_world.gov\n";
+    std::cout << "  " << programName << " parse --optimized hello_world.gov\n";
+    std::cout << "  " << programName << " compile hello_world.gov -o hello\n";
+    std::cout << "  " << programName << " profile hello_world.gov -o hello.folded\n";
+    std::cout << "  " << programName << " trace hello_world.gov && " << programName << " trace-export hello_world.govtrace\n";
+}
+
+// Commands that run the program on the tree interpreter to measure it
+bool instrumented(const std::string& command) {
+    return command == "profile" || command == "trace";
+}
+
+// `path` with the suffix `from` replaced by `to`, or with `to` appended when
+// it does not end in `from`
+std::string replaceExtension(const std::string& path, const std::string& from, const std::string& to) {
+    if (path.size() > from.size() && path.compare(path.size() - from.size(), from.size(), from) == 0) {
+        return path.substr(0, path.size() - from.size()) + to;
+    }
+    return path + to;
 }
 
 Config parseArgs(int argc, char* argv[]) {
@@ -71,7 +122,8 @@ Config parseArgs(int argc, char* argv[]) {
     size_t i = 0;
     
     // Check if first argument is a command
-    if (args[i] == "run" || args[i] == "parse" || args[i] == "debug") {
+    if (args[i] == "run" || args[i] == "parse" || args[i] == "debug" || args[i] == "compile" ||
+        args[i] == "profile" || args[i] == "trace" || args[i] == "trace-export") {
         config.command = args[i];
         i++;
     }
@@ -96,6 +148,56 @@ Config parseArgs(int argc, char* argv[]) {
         } else if (args[i] == "-s" || args[i] == "--step") {
             config.stepByStep = true;
             i++;
+        } else if (args[i].rfind("--engine=", 0) == 0) {
+            config.engine = args[i].substr(9);
+            if (config.engine != "tree" && config.engine != "vm" && config.engine != "closure") {
+                std::cerr << "Error: Unknown engine " << config.engine << ". Must be tree, vm or closure\n";
+                exit(1);
+            }
+            i++;
+        } else if (args[i].rfind("--flush=", 0) == 0) {
+            config.flush = args[i].substr(8);
+            FlushPolicy policy;
+            if (!parseFlushPolicy(config.flush, policy)) {
+                std::cerr << "Error: Unknown flush policy " << config.flush
+                          << ". Must be line, full or never-until-exit\n";
+                exit(1);
+            }
+            i++;
+        } else if (args[i].rfind("--threads=", 0) == 0) {
+            int threads = 0;
+            try {
+                threads = std::stoi(args[i].substr(10));
+            } catch (const std::exception&) {
+            }
+            if (threads < 1) {
+                std::cerr << "Error: --threads requires a positive number\n";
+                exit(1);
+            }
+            config.threads = static_cast<unsigned>(threads);
+            i++;
+        } else if (args[i] == "-o") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: -o requires an output name\n";
+                exit(1);
+            }
+            config.outputPath = args[i + 1];
+            i += 2;
+        } else if (args[i] == "--no-cache") {
+            config.cache = false;
+            i++;
+        } else if (args[i] == "--stats") {
+            config.stats = true;
+            i++;
+        } else if (args[i] == "--jit") {
+            config.jit = true;
+            i++;
+        } else if (args[i] == "-O0") {
+            config.optimizationLevel = 0;
+            i++;
+        } else if (args[i] == "-O1" || args[i] == "--optimized") {
+            config.optimizationLevel = 1;
+            i++;
         } else if (args[i][0] == '-') {
             std::cerr << "Error: Unknown option " << args[i] << "\n";
             exit(1);
@@ -103,7 +205,10 @@ Config parseArgs(int argc, char* argv[]) {
             // This should be the filename
             config.filename = args[i];
             i++;
-            break;
+            // Commands that write a file take -o after the input, like a C compiler
+            if (config.command != "compile" && !instrumented(config.command) && config.command != "trace-export") {
+                break;
+            }
         }
     }
     
@@ -113,6 +218,54 @@ Config parseArgs(int argc, char* argv[]) {
         exit(1);
     }
     
+    if ((config.command == "debug" || instrumented(config.command)) && config.engine != "tree") {
+        std::cerr << "Error: " << config.command << " command is only supported by the tree engine\n";
+        exit(1);
+    }
+    
+    if (config.command == "compile" && config.outputPath.empty()) {
+        config.outputPath = config.filename;
+        if (config.outputPath.size() > 4 && config.outputPath.compare(config.outputPath.size() - 4, 4, ".gov") == 0) {
+            config.outputPath.resize(config.outputPath.size() - 4);
+        } else {
+            config.outputPath += ".out";
+        }
+    }
+    if (config.command == "profile" && config.outputPath.empty()) {
+        config.outputPath = replaceExtension(config.filename, ".gov", ".folded");
+    }
+    if (config.command == "trace" && config.outputPath.empty()) {
+        config.outputPath = replaceExtension(config.filename, ".gov", ".govtrace");
+    }
+    if (config.command == "trace-export" && config.outputPath.empty()) {
+        config.outputPath = replaceExtension(config.filename, ".govtrace", ".json");
+    }
+    
+    if (config.jit && (config.engine == "vm" || config.command == "debug" || config.command == "compile" ||
+                       instrumented(config.command))) {
+        std::cerr << "Error: --jit is only supported by run with the tree or closure engine\n";
+        exit(1);
+    }
+    if (config.jit && !Jit::available()) {
+        std::cerr << "Warning: --jit is not available on this platform, loops will be interpreted\n";
+        config.jit = false;
+    }
+    
+    // Only run, compile, profile and trace optimize by default, so parse and
+    // debug show the code as written
+    if (config.optimizationLevel < 0) {
+        config.optimizationLevel =
+            (config.command == "run" || config.command == "compile" || instrumented(config.command)) ? 1 : 0;
+    }
+    
+    // Debug traces go to std::cout directly, so program output must not be
+    // held back behind them
+    if (config.command == "debug") {
+        config.flush = "line";
+    } else if (config.flush.empty() && config.command != "compile") {
+        config.flush = stdoutIsTerminal() ? "line" : "full";
+    }
+    
     // Set default debug level to 1 if debug command is used without explicit verbosity
     if (config.command == "debug" && !verbosityExplicitlySet) {
         config.debugLevel = 1;
@@ -217,7 +370,7 @@ void printAST(ASTNode* node, int indent = 0) {
     } else if (auto num = dynamic_cast<IntegerLiteral*>(node)) {
         std::cout << indentStr << "IntegerLiteral: " << num->value << "\n";
     } else if (auto id = dynamic_cast<Identifier*>(node)) {
-        std::cout << indentStr << "Identifier: " << id->name << "\n";
+        std::cout << indentStr << "Identifier: " << id->name << " (slot " << id->slot << ")\n";
     } else if (auto arr = dynamic_cast<ArrayAccess*>(node)) {
         std::cout << indentStr << "ArrayAccess\n";
         std::cout << indentStr << "  Array:\n";
@@ -229,23 +382,115 @@ void printAST(ASTNode* node, int indent = 0) {
     }
 }
 
-int main(int argc, char* argv[]) {
-    Config config = parseArgs(argc, argv);
+// Parses, resolves, type checks and optimizes the source. Returns nullptr
+// after reporting a fatal error; `diagnostics` counts the non-fatal ones.
+std::unique_ptr<Program> buildProgram(std::string_view source, const Config& config, Stats& stats, int& diagnostics) {
+    // The parser lexes as it goes; --stats times a separate pass to show
+    // what lexing alone costs
+    if (stats.isEnabled()) {
+        stats.begin("lex");
+        stats.set("tokens", Lexer(source, false).tokenize().size());
+    }
+    
+    // Parse, in parallel for large sources
+    stats.begin("parse");
+    auto program = parseSource(source, config.threads, &diagnostics);
+    
+    if (!program) {
+        std::cerr << "Parse error occurred" << std::endl;
+        return nullptr;
+    }
+    
+    if (config.debugLevel > 0) {
+        std::cout << "Program parsed successfully with " << program->statements.size() << " statements" << std::endl;
+    }
     
-    std::string source = readFile(config.filename);
+    // Resolve variable names to slots
+    stats.begin("resolve");
+    Resolver resolver;
+    if (!resolver.resolve(program.get())) {
+        std::cerr << "Name resolution failed" << std::endl;
+        return nullptr;
+    }
+    
+    if (config.debugLevel > 0) {
+        std::cout << "Variables resolved: " << program->slots.size() << " slots" << std::endl;
+    }
+    
+    // Check operand types and tag operators with what is known statically
+    stats.begin("typecheck");
+    TypeChecker typeChecker;
+    if (!typeChecker.check(program.get())) {
+        std::cerr << "Type checking failed" << std::endl;
+        return nullptr;
+    }
+    
+    if (config.optimizationLevel > 0) {
+        stats.begin("optimize");
+        Optimizer optimizer;
+        optimizer.optimize(program.get());
+        
+        if (config.debugLevel > 0) {
+            std::cout << "Optimized: " << optimizer.getFoldedExpressions() << " expressions folded, "
+                      << optimizer.getPrunedBranches() << " constant conditions removed" << std::endl;
+        }
+    }
+    stats.end();
+    
+    return program;
+}
+
+// Runs the program on the tree interpreter with `hooks` reporting on it
+template <typename Hooks>
+void interpretProgram(Program* program, const Config& config, Stats& stats, Hooks hooks) {
+    Interpreter<Hooks> interpreter(std::move(hooks));
+    stats.begin("execute");
+    interpreter.setJitEnabled(config.jit);
+    interpreter.interpret(program);
+    standardOutput().flush();
+    stats.end();
+    // NoHooks counts nothing; run only uses it without --stats
+    if constexpr (!std::is_same_v<Hooks, NoHooks>) {
+        stats.set("statements_executed", interpreter.getHooks().getStatementsExecuted());
+    }
+}
+
+int runCommand(const Config& config, Stats& stats) {
+    stats.set("command", config.command);
+    stats.set("file", config.filename);
+    
+    // trace-export reads a trace, not a program
+    if (config.command == "trace-export") {
+        stats.begin("export");
+        return exportChromeTrace(config.filename, config.outputPath) ? 0 : 1;
+    }
+    
+    stats.begin("read");
+    SourceFile file;
+    if (!file.open(config.filename)) {
+        return 1;
+    }
+    std::string_view source = file.text();
+    stats.end();
+    stats.set("source_bytes", source.size());
     if (source.empty()) {
         return 1;
     }
+    if (source.size() > Lexer::MAX_SOURCE_SIZE) {
+        std::cerr << "Error: " << config.filename << " is 4 GiB or larger, which gov cannot read" << std::endl;
+        return 1;
+    }
     
     if (config.debugLevel > 0) {
         std::cout << "Source loaded: " << source.length() << " characters" << std::endl;
     }
     
-    // Tokenize
-    Lexer lexer(source);
-    auto tokens = lexer.tokenize();
+    // The parser pulls tokens from the lexer as it goes. Debug output lists
+    // them up front, from a separate silent pass over the source.
+    std::vector<Token> tokens;
     
     if (config.debugLevel > 0) {
+        tokens = Lexer(source, false).tokenize();
         std::cout << "Tokens generated: " << tokens.size() << std::endl;
     }
     
@@ -300,35 +545,109 @@ int main(int argc, char* argv[]) {
                 case TokenType::READ: std::cout << "READ"; break;
                 default: std::cout << "UNKNOWN(" << static_cast<int>(tokens[i].type) << ")"; break;
             }
-            std::cout << " \"" << tokens[i].value << "\"\n";
+            std::cout << " \"" << tokens[i].text(source) << "\"\n";
         }
         std::cout << std::endl;
     }
     
-    // Parse
-    Parser parser(std::move(tokens));
-    auto program = parser.parse();
-    
+    // run, compile, profile and trace reuse an earlier build of the same
+    // source; parse and debug always show the pipeline at work
+    std::optional<ProgramCache> cache;
+    if (config.cache && config.debugLevel == 0 &&
+        (config.command == "run" || config.command == "compile" || instrumented(config.command))) {
+        cache.emplace(source, config.optimizationLevel);
+    }
+    std::unique_ptr<Program> program;
+    if (cache) {
+        stats.begin("cache_load");
+        program = cache->load();
+        stats.end();
+    }
+    stats.set("cache", !cache ? "off" : program ? "hit" : "miss");
     if (!program) {
-        std::cerr << "Parse error occurred" << std::endl;
-        return 1;
+        int diagnostics = 0;
+        program = buildProgram(source, config, stats, diagnostics);
+        if (!program) {
+            return 1;
+        }
+        // A build that reported errors is not cached, so they are reported
+        // again on the next run
+        if (cache && diagnostics == 0) {
+            stats.begin("cache_store");
+            cache->store(*program);
+            stats.end();
+        }
     }
-    
-    if (config.debugLevel > 0) {
-        std::cout << "Program parsed successfully with " << program->statements.size() << " statements" << std::endl;
+    if (stats.isEnabled()) {
+        stats.set("nodes", countNodes(*program));
     }
     
     // Execute based on command
     if (config.command == "parse") {
+        stats.begin("print");
         std::cout << "\nAbstract Syntax Tree:\n";
         std::cout << "=====================\n";
         printAST(program.get());
+        
+        if (config.engine == "vm") {
+            std::cout << "\nBytecode:\n";
+            std::cout << "=========\n";
+            Compiler compiler;
+            disassemble(compiler.compile(program.get()));
+        }
+        return 0;
+    }
+    
+    if (config.command == "compile") {
+        stats.begin("compile");
+        CodeGenerator generator;
+        std::string code = generator.generate(program.get(), config.filename, config.flush);
+        const std::string& output = config.outputPath;
+        if (output.size() > 4 && output.compare(output.size() - 4, 4, ".cpp") == 0) {
+            std::ofstream file(output, std::ios::binary);
+            file << code;
+            if (!file) {
+                std::cerr << "Error: Could not write " << output << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        return buildExecutable(code, output) ? 0 : 1;
+    }
+    
+    FlushPolicy flushPolicy;
+    parseFlushPolicy(config.flush, flushPolicy);
+    standardOutput().setPolicy(flushPolicy);
+    
+    stats.set("engine", config.engine);
+    
+    // The VM runs bytecode, so it has no statement count
+    if (config.engine == "vm") {
+        stats.begin("execute");
+        Compiler compiler;
+        Chunk chunk = compiler.compile(program.get());
+        VM vm;
+        vm.run(chunk);
+        standardOutput().flush();
+        stats.end();
+        stats.setNull("statements_executed");
         return 0;
     }
     
-    // For run and debug commands
-    Interpreter interpreter;
+    if (config.engine == "closure") {
+        stats.begin("execute");
+        ClosureEngine engine;
+        engine.setJitEnabled(config.jit);
+        engine.setCountStatements(stats.isEnabled());
+        engine.run(program.get());
+        standardOutput().flush();
+        stats.end();
+        stats.set("statements_executed", engine.getStatementsExecuted());
+        return 0;
+    }
     
+    // run, debug and profile share the tree interpreter, specialized on
+    // what it reports
     if (config.command == "debug") {
         std::cout << "\nDebug Mode (Level " << config.debugLevel << ")\n";
         std::cout << "=====================================\n";
@@ -337,10 +656,58 @@ int main(int argc, char* argv[]) {
             std::cout << "Step-by-step execution enabled. Press Enter to continue after each step.\n\n";
         }
         
-        interpreter.setDebugMode(true, config.debugLevel, config.stepByStep);
+        interpretProgram(program.get(), config, stats, DebugHooks(config.debugLevel, config.stepByStep));
+        return 0;
     }
     
-    interpreter.interpret(program.get());
+    if (config.command == "trace") {
+        Tracer tracer(*program, config.filename);
+        if (!tracer.open(config.outputPath)) {
+            return 1;
+        }
+        interpretProgram(program.get(), config, stats, TraceHooks(tracer));
+        if (!tracer.close()) {
+            std::cerr << "Error: Could not write " << config.outputPath << std::endl;
+            return 1;
+        }
+        stats.set("trace_events", tracer.eventCount());
+        stats.set("trace_full_ring_waits", tracer.fullRingWaits());
+        std::cerr << "Trace of " << tracer.eventCount() << " events written to " << config.outputPath << std::endl;
+        return 0;
+    }
+    
+    if (config.command == "profile") {
+        Profiler profiler(*program, config.filename);
+        interpretProgram(program.get(), config, stats, ProfileHooks(profiler));
+        std::cerr << "\nProfile of " << config.filename << ": ";
+        profiler.report(std::cerr, source);
+        if (!profiler.writeFolded(config.outputPath)) {
+            return 1;
+        }
+        std::cerr << "\nFolded stacks written to " << config.outputPath << std::endl;
+        return 0;
+    }
     
+    if (stats.isEnabled()) {
+        interpretProgram(program.get(), config, stats, CountingHooks());
+    } else {
+        interpretProgram(program.get(), config, stats, NoHooks());
+    }
     return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Config config = parseArgs(argc, argv);
+    Stats stats(config.stats);
+    int status = 1;
+    try {
+        status = runCommand(config, stats);
+    } catch (const std::length_error& error) {
+        std::cerr << "Error: " << error.what() << std::endl;
+    } catch (const std::bad_alloc&) {
+        std::cerr << "Error: Out of memory" << std::endl;
+    }
+    stats.set("exit_status", static_cast<uint64_t>(status));
+    stats.write(std::cerr);
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "optimizer.h"
+#include "value.h"
+
+// Literal value of `expr`, or false when it is not a literal
+static bool literalValue(Expression* expr, Value& out) {
+    if (auto literal = dynamic_cast<IntegerLiteral*>(expr)) {
+        out = literal->value;
+        return true;
+    }
+    if (auto literal = dynamic_cast<StringLiteral*>(expr)) {
+        out = literal->value;
+        return true;
+    }
+    return false;
+}
+
+NodePtr<Expression> Optimizer::makeLiteral(const Value& value, const ASTNode* at) {
+    NodePtr<Expression> literal;
+    if (value.isInt()) {
+        literal = arena->make<IntegerLiteral>(value.asInt());
+    } else {
+        literal = arena->make<StringLiteral>(arena->copy(valueToString(value)));
+    }
+    literal->line = at->line;
+    literal->column = at->column;
+    return literal;
+}
+
+static Value applyOperator(TokenType op, const Value& left, const Value& right) {
+    switch (op) {
+        case TokenType::PLUS: return addValues(left, right);
+        case TokenType::MINUS: return subtractValues(left, right);
+        case TokenType::MULTIPLY: return multiplyValues(left, right);
+        case TokenType::DIVIDE: return divideValues(left, right);
+        case TokenType::EQUALS: return equalValues(left, right);
+        case TokenType::NOT_EQUALS: return notEqualValues(left, right);
+        case TokenType::LESS_THAN: return lessThanValues(left, right);
+        case TokenType::AND: return andValues(left, right);
+        case TokenType::OR: return orValues(left, right);
+        default: return 0;
+    }
+}
+
+void Optimizer::foldExpression(NodePtr<Expression>& expr) {
+    if (auto access = dynamic_cast<ArrayAccess*>(expr.get())) {
+        foldExpression(access->index);
+        return;
+    }
+
+    auto binOp = dynamic_cast<BinaryOp*>(expr.get());
+    if (!binOp) {
+        return;
+    }
+
+    foldExpression(binOp->left);
+    foldExpression(binOp->right);
+
+    Value left, right;
+    bool leftConstant = literalValue(binOp->left.get(), left);
+    bool rightConstant = literalValue(binOp->right.get(), right);
+
+    if (leftConstant && rightConstant) {
+        expr = makeLiteral(applyOperator(binOp->op, left, right), binOp);
+        foldedExpressions++;
+        return;
+    }
+
+    // Expressions have no side effects, so one constant operand can decide
+    // AND/OR on its own
+    bool constantSide = leftConstant || rightConstant;
+    bool sideTruthy = isTruthy(leftConstant ? left : right);
+    if (constantSide && binOp->op == TokenType::AND && !sideTruthy) {
+        expr = makeLiteral(0, binOp);
+        foldedExpressions++;
+    } else if (constantSide && binOp->op == TokenType::OR && sideTruthy) {
+        expr = makeLiteral(1, binOp);
+        foldedExpressions++;
+    }
+}
+
+// True when `expr` is a literal; `truthy` then holds its condition value
+static bool constantCondition(Expression* expr, bool& truthy) {
+    Value value;
+    if (!literalValue(expr, value)) {
+        return false;
+    }
+    truthy = isTruthy(value);
+    return true;
+}
+
+void Optimizer::optimizeBlock(NodeList<Statement>& block) {
+    NodeList<Statement> out(block.get_allocator());
+    out.reserve(block.size());
+    for (auto& stmt : block) {
+        optimizeStatement(std::move(stmt), out);
+    }
+    block = std::move(out);
+}
+
+static void spliceBlock(NodeList<Statement>& block, NodeList<Statement>& out) {
+    for (auto& stmt : block) {
+        out.push_back(std::move(stmt));
+    }
+}
+
+void Optimizer::optimizeStatement(NodePtr<Statement> stmt, NodeList<Statement>& out) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt.get())) {
+        foldExpression(print->expr);
+    } else if (auto assign = dynamic_cast<Assignment*>(stmt.get())) {
+        foldExpression(assign->value);
+        if (assign->index) {
+            foldExpression(assign->index);
+        }
+        // Folding may have replaced operands of a self-append chain, whose
+        // spine of PLUS nodes itself never folds; refresh the pointers
+        Expression* spine = assign->value.get();
+        for (size_t i = assign->appendOperands.size(); i-- > 0;) {
+            auto binOp = static_cast<BinaryOp*>(spine);
+            assign->appendOperands[i] = binOp->right.get();
+            spine = binOp->left.get();
+        }
+    } else if (auto forLoop = dynamic_cast<ForLoop*>(stmt.get())) {
+        foldExpression(forLoop->condition);
+        bool truthy;
+        if (constantCondition(forLoop->condition.get(), truthy) && !truthy) {
+            prunedBranches++;
+            return;
+        }
+        optimizeBlock(forLoop->body);
+    } else if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt.get())) {
+        foldExpression(whileLoop->condition);
+        bool truthy;
+        if (constantCondition(whileLoop->condition.get(), truthy) && !truthy) {
+            prunedBranches++;
+            return;
+        }
+        optimizeBlock(whileLoop->body);
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(stmt.get())) {
+        foldExpression(ifStmt->condition);
+        for (auto& clause : ifStmt->elseIfClauses) {
+            foldExpression(clause.condition);
+        }
+
+        // Drop ELSE_IF clauses that can never be taken; a clause that is
+        // always taken becomes the ELSE and cuts off everything after it
+        std::pmr::vector<ElseIfClause> clauses(ifStmt->elseIfClauses.get_allocator());
+        for (auto& clause : ifStmt->elseIfClauses) {
+            bool truthy;
+            if (!constantCondition(clause.condition.get(), truthy)) {
+                clauses.push_back(std::move(clause));
+                continue;
+            }
+            prunedBranches++;
+            if (truthy) {
+                ifStmt->elseBranch = std::move(clause.body);
+                break;
+            }
+        }
+        ifStmt->elseIfClauses = std::move(clauses);
+
+        // A constant IF condition either replaces the statement with its
+        // THEN branch or hands the decision to the next clause
+        bool truthy;
+        while (constantCondition(ifStmt->condition.get(), truthy)) {
+            prunedBranches++;
+            if (truthy) {
+                optimizeBlock(ifStmt->thenBranch);
+                spliceBlock(ifStmt->thenBranch, out);
+                return;
+            }
+            if (ifStmt->elseIfClauses.empty()) {
+                optimizeBlock(ifStmt->elseBranch);
+                spliceBlock(ifStmt->elseBranch, out);
+                return;
+            }
+            ifStmt->condition = std::move(ifStmt->elseIfClauses.front().condition);
+            ifStmt->thenBranch = std::move(ifStmt->elseIfClauses.front().body);
+            ifStmt->elseIfClauses.erase(ifStmt->elseIfClauses.begin());
+        }
+
+        optimizeBlock(ifStmt->thenBranch);
+        for (auto& clause : ifStmt->elseIfClauses) {
+            optimizeBlock(clause.body);
+        }
+        optimizeBlock(ifStmt->elseBranch);
+    }
+
+    out.push_back(std::move(stmt));
+}
+
+void Optimizer::optimize(Program* program) {
+    foldedExpressions = 0;
+    prunedBranches = 0;
+    arena = program->arena.get();
+    optimizeBlock(program->statements);
+}
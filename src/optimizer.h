@@ -0,0 +1,26 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+
+// Optional pass that runs after the Resolver (-O1). Folds operators whose
+// operands are all literals, using the same value kernels as the engines,
+// and removes IF/ELSE_IF branches and loops whose condition is a constant.
+class Optimizer {
+private:
+    int foldedExpressions = 0;
+    int prunedBranches = 0; // conditions decided before execution
+    Arena* arena = nullptr;  // folded literals are added to the program's arena
+
+    NodePtr<Expression> makeLiteral(const Value& value, const ASTNode* at);
+
+    void foldExpression(NodePtr<Expression>& expr);
+    void optimizeBlock(NodeList<Statement>& block);
+    // Appends the optimized form of `stmt` to `out`; dead code appends nothing
+    void optimizeStatement(NodePtr<Statement> stmt, NodeList<Statement>& out);
+
+public:
+    void optimize(Program* program);
+
+    int getFoldedExpressions() const { return foldedExpressions; }
+    int getPrunedBranches() const { return prunedBranches; }
+};
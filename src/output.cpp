@@ -0,0 +1,112 @@
+#include "output.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+Output::Output() : buffer(BUFFER_SIZE) {}
+
+Output::~Output() {
+    flush();
+}
+
+// Makes room for `bytes` more characters, flushing or growing the buffer
+void Output::reserve(size_t bytes) {
+    if (used + bytes <= buffer.size()) {
+        return;
+    }
+    if (policy == FlushPolicy::NEVER_UNTIL_EXIT) {
+        buffer.resize(std::max(buffer.size() * 2, used + bytes));
+        return;
+    }
+    flush();
+    if (bytes > buffer.size()) {
+        buffer.resize(bytes);
+    }
+}
+
+void Output::write(std::string_view text) {
+    reserve(text.size());
+    std::memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void Output::writeValue(const Value& value) {
+    switch (value.kind()) {
+        case Value::Kind::INTEGER: {
+            reserve(16);
+            auto result = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value.asInt());
+            used = result.ptr - buffer.data();
+            break;
+        }
+        case Value::Kind::STRING:
+            write(value.asString());
+            break;
+        case Value::Kind::ARRAY: {
+            auto& elements = value.asArray();
+            write("[");
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (i > 0) write(", ");
+                write(elements[i].asString());
+            }
+            write("]");
+            break;
+        }
+    }
+}
+
+void Output::printLine(const Value& value) {
+    writeValue(value);
+    write("\n");
+    if (policy == FlushPolicy::LINE) {
+        flush();
+    }
+}
+
+// Goes through stdio so text printed with std::cout elsewhere (debug
+// traces, prompts) stays in order with program output
+void Output::flush() {
+    if (used > 0) {
+        std::fwrite(buffer.data(), 1, used, stdout);
+        used = 0;
+    }
+    std::fflush(stdout);
+}
+
+void Output::flushForInput() {
+    if (policy != FlushPolicy::NEVER_UNTIL_EXIT) {
+        flush();
+    }
+}
+
+Output& standardOutput() {
+    static Output output;
+    return output;
+}
+
+bool stdoutIsTerminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdout)) != 0;
+#else
+    return isatty(fileno(stdout)) != 0;
+#endif
+}
+
+bool parseFlushPolicy(const std::string& name, FlushPolicy& policy) {
+    if (name == "line") {
+        policy = FlushPolicy::LINE;
+    } else if (name == "full") {
+        policy = FlushPolicy::FULL;
+    } else if (name == "never-until-exit") {
+        policy = FlushPolicy::NEVER_UNTIL_EXIT;
+    } else {
+        return false;
+    }
+    return true;
+}
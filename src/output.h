@@ -0,0 +1,51 @@
+#pragma once
+#include "value.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// When buffered program output reaches stdout
+enum class FlushPolicy {
+    LINE,             // after every printed line
+    FULL,             // when the buffer fills up
+    NEVER_UNTIL_EXIT  // once, when the program ends; the buffer grows as needed
+};
+
+// Buffered writer for PRAISE_LEADER. Values are formatted straight into one
+// large buffer (integers with to_chars, arrays element by element) and
+// handed to stdout in bulk according to the flush policy. The buffer is
+// always emptied before READ blocks for input and when the writer is
+// destroyed at exit.
+class Output {
+private:
+    std::vector<char> buffer;
+    size_t used = 0;
+    FlushPolicy policy = FlushPolicy::LINE;
+
+    void reserve(size_t bytes);
+
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    Output();
+    ~Output();
+
+    void setPolicy(FlushPolicy policy) { this->policy = policy; }
+    FlushPolicy getPolicy() const { return policy; }
+
+    void write(std::string_view text);
+    void writeValue(const Value& value);
+    void printLine(const Value& value);
+
+    void flush();
+    // Called before reading standard input so prompts are visible
+    void flushForInput();
+};
+
+// The writer shared by all engines
+Output& standardOutput();
+
+bool stdoutIsTerminal();
+
+// Parses a --flush= argument; returns false for unknown names
+bool parseFlushPolicy(const std::string& name, FlushPolicy& policy);
@@ -1,14 +1,28 @@
 #include "parser.h"
+#include <charconv>
 #include <iostream>
+#include <stdexcept>
 
-Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)), current(0) {}
+Parser::Parser(Lexer& lexer, bool reportErrors)
+    : lexer(lexer), source(lexer.getSource()), currentToken(lexer.next()), previousToken(), current(0),
+      reportErrors(reportErrors) {}
 
-Token Parser::peek() {
-    return tokens[current];
+// Records where a node starts so later passes can report diagnostics
+template <typename T>
+static NodePtr<T> locate(NodePtr<T> node, const Token& token) {
+    if (node) {
+        node->line = token.line;
+        node->column = token.column;
+    }
+    return node;
+}
+
+const Token& Parser::peek() {
+    return currentToken;
 }
 
-Token Parser::previous() {
-    return tokens[current - 1];
+const Token& Parser::previous() {
+    return previousToken;
 }
 
 bool Parser::isAtEnd() {
@@ -30,36 +44,54 @@ bool Parser::match(std::initializer_list<TokenType> types) {
     return false;
 }
 
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+const Token& Parser::advance() {
+    if (!isAtEnd()) {
+        previousToken = currentToken;
+        currentToken = lexer.next();
+        current++;
+    }
     return previous();
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
+const Token& Parser::consume(TokenType type, const char* message) {
     if (check(type)) return advance();
     
-    std::cerr << "Parse error: " << message << " at line " << peek().line << std::endl;
+    errors++;
+    if (reportErrors) {
+        std::cerr << "Parse error: " << message << " at line " << peek().line << std::endl;
+    }
     return peek();
 }
 
+// Value of an INTEGER token. Out-of-range literals throw like std::stoi
+// did, which parse() reports as a parse failure.
+int Parser::integer(const Token& token) const {
+    std::string_view digits = text(token);
+    int value = 0;
+    if (std::from_chars(digits.data(), digits.data() + digits.size(), value).ec != std::errc()) {
+        throw std::out_of_range("integer literal out of range");
+    }
+    return value;
+}
+
 void Parser::skipNewlines() {
     while (match({TokenType::NEWLINE})) {}
 }
 
-std::unique_ptr<Expression> Parser::expression() {
+NodePtr<Expression> Parser::expression() {
     return logicalOr();
 }
 
-std::unique_ptr<Expression> Parser::logicalOr() {
+NodePtr<Expression> Parser::logicalOr() {
     auto expr = logicalAnd();
     
     while (true) {
         skipNewlines();
         if (match({TokenType::OR})) {
-            TokenType op = previous().type;
+            Token op = previous();
             skipNewlines();
             auto right = logicalAnd();
-            expr = std::make_unique<BinaryOp>(std::move(expr), op, std::move(right));
+            expr = locate(arena->make<BinaryOp>(std::move(expr), op.type, std::move(right)), op);
         } else {
             break;
         }
@@ -68,16 +100,16 @@ std::unique_ptr<Expression> Parser::logicalOr() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalAnd() {
+NodePtr<Expression> Parser::logicalAnd() {
     auto expr = equality();
     
     while (true) {
         skipNewlines();
         if (match({TokenType::AND})) {
-            TokenType op = previous().type;
+            Token op = previous();
             skipNewlines();
             auto right = equality();
-            expr = std::make_unique<BinaryOp>(std::move(expr), op, std::move(right));
+            expr = locate(arena->make<BinaryOp>(std::move(expr), op.type, std::move(right)), op);
         } else {
             break;
         }
@@ -86,16 +118,16 @@ std::unique_ptr<Expression> Parser::logicalAnd() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::equality() {
+NodePtr<Expression> Parser::equality() {
     auto expr = addition();
     
     while (true) {
         skipNewlines();
         if (match({TokenType::EQUALS, TokenType::NOT_EQUALS, TokenType::LESS_THAN})) {
-            TokenType op = previous().type;
+            Token op = previous();
             skipNewlines();
             auto right = addition();
-            expr = std::make_unique<BinaryOp>(std::move(expr), op, std::move(right));
+            expr = locate(arena->make<BinaryOp>(std::move(expr), op.type, std::move(right)), op);
         } else {
             break;
         }
@@ -104,16 +136,16 @@ std::unique_ptr<Expression> Parser::equality() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::addition() {
+NodePtr<Expression> Parser::addition() {
     auto expr = multiplication();
     
     while (true) {
         skipNewlines();
         if (match({TokenType::PLUS, TokenType::MINUS})) {
-            TokenType op = previous().type;
+            Token op = previous();
             skipNewlines();
             auto right = multiplication();
-            expr = std::make_unique<BinaryOp>(std::move(expr), op, std::move(right));
+            expr = locate(arena->make<BinaryOp>(std::move(expr), op.type, std::move(right)), op);
         } else {
             break;
         }
@@ -122,16 +154,16 @@ std::unique_ptr<Expression> Parser::addition() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::multiplication() {
+NodePtr<Expression> Parser::multiplication() {
     auto expr = primary();
     
     while (true) {
         skipNewlines();
         if (match({TokenType::MULTIPLY, TokenType::DIVIDE})) {
-            TokenType op = previous().type;
+            Token op = previous();
             skipNewlines();
             auto right = primary();
-            expr = std::make_unique<BinaryOp>(std::move(expr), op, std::move(right));
+            expr = locate(arena->make<BinaryOp>(std::move(expr), op.type, std::move(right)), op);
         } else {
             break;
         }
@@ -140,13 +172,13 @@ std::unique_ptr<Expression> Parser::multiplication() {
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::primary() {
+NodePtr<Expression> Parser::primary() {
     if (match({TokenType::STRING})) {
-        return std::make_unique<StringLiteral>(previous().value);
+        return locate(arena->make<StringLiteral>(arena->copy(text(previous()))), previous());
     }
     
     if (match({TokenType::INTEGER})) {
-        return std::make_unique<IntegerLiteral>(std::stoi(previous().value));
+        return locate(arena->make<IntegerLiteral>(integer(previous())), previous());
     }
     
     if (match({TokenType::LEFT_PAREN})) {
@@ -156,50 +188,55 @@ std::unique_ptr<Expression> Parser::primary() {
     }
     
     if (match({TokenType::IDENTIFIER})) {
-        std::string name = previous().value;
+        Token nameToken = previous();
+        auto id = locate(arena->make<Identifier>(arena->copy(text(nameToken))), nameToken);
         
         if (match({TokenType::LEFT_BRACKET})) {
             auto index = expression();
             consume(TokenType::RIGHT_BRACKET, "Expected ']' after array index");
-            return std::make_unique<ArrayAccess>(std::make_unique<Identifier>(name), std::move(index));
+            return locate(arena->make<ArrayAccess>(std::move(id), std::move(index)), nameToken);
         }
         
-        return std::make_unique<Identifier>(name);
+        return id;
     }
     
-    std::cerr << "Expected expression at line " << peek().line << std::endl;
+    errors++;
+    if (reportErrors) {
+        std::cerr << "Expected expression at line " << peek().line << std::endl;
+    }
     return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::statement() {
+NodePtr<Statement> Parser::statement() {
     skipNewlines();
+    Token start = peek();
     
     if (match({TokenType::PRAISE_LEADER})) {
-        return printStatement();
+        return locate(printStatement(), start);
     }
     
     if (match({TokenType::PLEASE})) {
         if (match({TokenType::DECLARE_VARIABLE})) {
-            return varDeclaration();
+            return locate(varDeclaration(), start);
         } else if (match({TokenType::SET})) {
-            return assignment();
+            return locate(assignment(), start);
         } else if (match({TokenType::INCREMENT})) {
-            return incrementStatement();
+            return locate(incrementStatement(), start);
         } else if (match({TokenType::READ})) {
-            return readStatement();
+            return locate(readStatement(), start);
         }
     }
     
     if (match({TokenType::FOR_THE_PEOPLE})) {
-        return forLoop();
+        return locate(forLoop(), start);
     }
     
     if (match({TokenType::WHILE})) {
-        return whileLoop();
+        return locate(whileLoop(), start);
     }
     
     if (match({TokenType::IF})) {
-        return ifStatement();
+        return locate(ifStatement(), start);
     }
     
     // Skip comments and other tokens
@@ -214,18 +251,18 @@ std::unique_ptr<Statement> Parser::statement() {
     return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::printStatement() {
+NodePtr<Statement> Parser::printStatement() {
     auto expr = expression();
-    return std::make_unique<PrintStatement>(std::move(expr));
+    return arena->make<PrintStatement>(std::move(expr));
 }
 
-std::unique_ptr<Statement> Parser::varDeclaration() {
+NodePtr<Statement> Parser::varDeclaration() {
     consume(TokenType::STRING, "Expected variable name in quotes");
-    std::string name = previous().value;
+    std::string_view name = arena->copy(text(previous()));
     
     consume(TokenType::AS, "Expected 'AS' after variable name");
     
-    std::string type;
+    std::string_view type;
     int arraySize = 0;
     
     if (match({TokenType::INTEGER_TYPE})) {
@@ -236,17 +273,17 @@ std::unique_ptr<Statement> Parser::varDeclaration() {
         type = "ARRAY_OF_STRING";
         consume(TokenType::SIZE, "Expected 'SIZE' after ARRAY_OF_STRING");
         consume(TokenType::INTEGER, "Expected array size");
-        arraySize = std::stoi(previous().value);
+        arraySize = integer(previous());
     }
     
-    return std::make_unique<VarDeclaration>(name, type, arraySize);
+    return arena->make<VarDeclaration>(name, type, arraySize);
 }
 
-std::unique_ptr<Statement> Parser::assignment() {
+NodePtr<Statement> Parser::assignment() {
     consume(TokenType::IDENTIFIER, "Expected variable name");
-    std::string varName = previous().value;
+    std::string_view varName = arena->copy(text(previous()));
     
-    std::unique_ptr<Expression> index = nullptr;
+    NodePtr<Expression> index = nullptr;
     if (match({TokenType::LEFT_BRACKET})) {
         index = expression();
         consume(TokenType::RIGHT_BRACKET, "Expected ']' after array index");
@@ -255,16 +292,16 @@ std::unique_ptr<Statement> Parser::assignment() {
     consume(TokenType::TO, "Expected 'TO' in assignment");
     auto value = expression();
     
-    return std::make_unique<Assignment>(varName, std::move(value), std::move(index));
+    return arena->make<Assignment>(varName, std::move(value), std::move(index), arena->resource());
 }
 
-std::unique_ptr<Statement> Parser::forLoop() {
+NodePtr<Statement> Parser::forLoop() {
     // Parse the full condition expression (e.g., "GloriousCounter LESS_THAN 3")
     auto condition = expression();
     consume(TokenType::DO, "Expected 'DO' after for condition");
     
     // For now, we'll use an empty string for varName since the condition contains the variable
-    auto loop = std::make_unique<ForLoop>("", std::move(condition));
+    auto loop = arena->make<ForLoop>("", std::move(condition), arena->resource());
     
     skipNewlines();
     while (!check(TokenType::END_FOR_THE_PEOPLE) && !isAtEnd()) {
@@ -280,11 +317,11 @@ std::unique_ptr<Statement> Parser::forLoop() {
     return std::move(loop);
 }
 
-std::unique_ptr<Statement> Parser::whileLoop() {
+NodePtr<Statement> Parser::whileLoop() {
     auto condition = expression();
     consume(TokenType::DO, "Expected 'DO' after while condition");
     
-    auto loop = std::make_unique<WhileLoop>(std::move(condition));
+    auto loop = arena->make<WhileLoop>(std::move(condition), arena->resource());
     
     skipNewlines();
     while (!check(TokenType::END_WHILE) && !isAtEnd()) {
@@ -300,11 +337,11 @@ std::unique_ptr<Statement> Parser::whileLoop() {
     return std::move(loop);
 }
 
-std::unique_ptr<Statement> Parser::ifStatement() {
+NodePtr<Statement> Parser::ifStatement() {
     auto condition = expression();
     consume(TokenType::THEN, "Expected 'THEN' after if condition");
     
-    auto ifStmt = std::make_unique<IfStatement>(std::move(condition));
+    auto ifStmt = arena->make<IfStatement>(std::move(condition), arena->resource());
     
     skipNewlines();
     while (!check(TokenType::ELSE_IF) && !check(TokenType::ELSE) && !check(TokenType::END_IF) && !isAtEnd()) {
@@ -320,7 +357,7 @@ std::unique_ptr<Statement> Parser::ifStatement() {
         auto elseIfCondition = expression();
         consume(TokenType::THEN, "Expected 'THEN' after else-if condition");
         
-        ElseIfClause elseIfClause(std::move(elseIfCondition));
+        ElseIfClause elseIfClause(std::move(elseIfCondition), arena->resource());
         
         skipNewlines();
         while (!check(TokenType::ELSE_IF) && !check(TokenType::ELSE) && !check(TokenType::END_IF) && !isAtEnd()) {
@@ -350,26 +387,27 @@ std::unique_ptr<Statement> Parser::ifStatement() {
     return std::move(ifStmt);
 }
 
-std::unique_ptr<Statement> Parser::incrementStatement() {
+NodePtr<Statement> Parser::incrementStatement() {
     consume(TokenType::IDENTIFIER, "Expected variable name");
-    std::string varName = previous().value;
+    std::string_view varName = arena->copy(text(previous()));
     
     consume(TokenType::BY, "Expected 'BY' after INCREMENT");
     consume(TokenType::INTEGER, "Expected increment amount");
-    int amount = std::stoi(previous().value);
+    int amount = integer(previous());
     
-    return std::make_unique<IncrementStatement>(varName, amount);
+    return arena->make<IncrementStatement>(varName, amount);
 }
 
-std::unique_ptr<Statement> Parser::readStatement() {
+NodePtr<Statement> Parser::readStatement() {
     consume(TokenType::IDENTIFIER, "Expected variable name");
-    std::string varName = previous().value;
+    std::string_view varName = arena->copy(text(previous()));
     
-    return std::make_unique<ReadStatement>(varName);
+    return arena->make<ReadStatement>(varName);
 }
 
 std::unique_ptr<Program> Parser::parse() {
-    auto program = std::make_unique<Program>();
+    auto program = std::make_unique<Program>(std::make_unique<Arena>());
+    arena = program->arena.get();
     
     // Skip initial header
     if (match({TokenType::I_LOVE_GOVERNMENT})) {
@@ -384,10 +422,54 @@ std::unique_ptr<Program> Parser::parse() {
             }
             skipNewlines();
         } catch (...) {
-            std::cerr << "Exception during parsing at token " << current << std::endl;
+            if (reportErrors) {
+                std::cerr << "Exception during parsing at token " << current << std::endl;
+            }
             return nullptr;
         }
     }
     
     return program;
-}
\ No newline at end of file
+}
+
+std::unique_ptr<Program> Parser::parseChunk(bool first) {
+    auto program = std::make_unique<Program>(std::make_unique<Arena>());
+    arena = program->arena.get();
+    
+    if (first && match({TokenType::I_LOVE_GOVERNMENT})) {
+        skipNewlines();
+    }
+    
+    try {
+        while (!isAtEnd()) {
+            size_t before = current;
+            auto stmt = statement();
+            if (stmt) {
+                program->statements.push_back(std::move(stmt));
+            } else if (current == before) {
+                // No statement starts here; parse() reports what it makes of it
+                return nullptr;
+            }
+            skipNewlines();
+        }
+    } catch (...) {
+        return nullptr;
+    }
+    
+    if (errors > 0 || lexer.errorCount() > 0) {
+        return nullptr;
+    }
+    return program;
+}
+
+const char* statementKeyword(const Statement* stmt) {
+    if (dynamic_cast<const PrintStatement*>(stmt)) return "PRAISE_LEADER";
+    if (dynamic_cast<const VarDeclaration*>(stmt)) return "DECLARE_VARIABLE";
+    if (dynamic_cast<const Assignment*>(stmt)) return "SET";
+    if (dynamic_cast<const ForLoop*>(stmt)) return "FOR_THE_PEOPLE";
+    if (dynamic_cast<const WhileLoop*>(stmt)) return "WHILE";
+    if (dynamic_cast<const IfStatement*>(stmt)) return "IF";
+    if (dynamic_cast<const IncrementStatement*>(stmt)) return "INCREMENT";
+    if (dynamic_cast<const ReadStatement*>(stmt)) return "READ";
+    return "STATEMENT";
+}
@@ -1,10 +1,17 @@
 #pragma once
 #include "lexer.h"
+#include "arena.h"
 #include <memory>
+#include <string_view>
 #include <variant>
 
-// AST Node types
+// AST Node types. Nodes are allocated in the Program's Arena and are never
+// destroyed individually, so every member must keep its memory there too:
+// names are views of text copied into the arena and child lists use its
+// memory resource.
 struct ASTNode {
+    int line = 0;
+    int column = 0;
     virtual ~ASTNode() = default;
 };
 
@@ -18,8 +25,8 @@ struct Statement : ASTNode {
 
 // Expressions
 struct StringLiteral : Expression {
-    std::string value;
-    StringLiteral(const std::string& val) : value(val) {}
+    std::string_view value;
+    StringLiteral(std::string_view val) : value(val) {}
 };
 
 struct IntegerLiteral : Expression {
@@ -28,123 +35,179 @@ struct IntegerLiteral : Expression {
 };
 
 struct Identifier : Expression {
-    std::string name;
-    Identifier(const std::string& n) : name(n) {}
+    std::string_view name;
+    int slot = -1; // filled in by the Resolver
+    Identifier(std::string_view n) : name(n) {}
 };
 
 struct ArrayAccess : Expression {
-    std::unique_ptr<Expression> array;
-    std::unique_ptr<Expression> index;
-    ArrayAccess(std::unique_ptr<Expression> arr, std::unique_ptr<Expression> idx) 
+    NodePtr<Expression> array;
+    NodePtr<Expression> index;
+    ArrayAccess(NodePtr<Expression> arr, NodePtr<Expression> idx)
         : array(std::move(arr)), index(std::move(idx)) {}
 };
 
+// Operand types of a BinaryOp as proven by the TypeChecker. GENERIC means
+// at least one side is only known at runtime; MIXED is one INTEGER and one
+// STRING in either order.
+enum class OperandTypes : uint8_t { GENERIC, INT_INT, STRING_STRING, MIXED };
+
 struct BinaryOp : Expression {
-    std::unique_ptr<Expression> left;
-    std::unique_ptr<Expression> right;
+    NodePtr<Expression> left;
+    NodePtr<Expression> right;
     TokenType op;
-    BinaryOp(std::unique_ptr<Expression> l, TokenType o, std::unique_ptr<Expression> r)
+    OperandTypes operands = OperandTypes::GENERIC;
+    BinaryOp(NodePtr<Expression> l, TokenType o, NodePtr<Expression> r)
         : left(std::move(l)), op(o), right(std::move(r)) {}
 };
 
 // Statements
 struct PrintStatement : Statement {
-    std::unique_ptr<Expression> expr;
-    PrintStatement(std::unique_ptr<Expression> e) : expr(std::move(e)) {}
+    NodePtr<Expression> expr;
+    PrintStatement(NodePtr<Expression> e) : expr(std::move(e)) {}
 };
 
 struct VarDeclaration : Statement {
-    std::string name;
-    std::string type;
+    std::string_view name;
+    std::string_view type;
     int arraySize;
-    VarDeclaration(const std::string& n, const std::string& t, int size = 0) 
+    int slot = -1;
+    VarDeclaration(std::string_view n, std::string_view t, int size = 0)
         : name(n), type(t), arraySize(size) {}
 };
 
 struct Assignment : Statement {
-    std::string varName;
-    std::unique_ptr<Expression> index; // for array assignment
-    std::unique_ptr<Expression> value;
-    Assignment(const std::string& name, std::unique_ptr<Expression> val, std::unique_ptr<Expression> idx = nullptr)
-        : varName(name), value(std::move(val)), index(std::move(idx)) {}
+    std::string_view varName;
+    int slot = -1;
+    NodePtr<Expression> index; // for array assignment
+    NodePtr<Expression> value;
+    // Set by the Resolver for `SET S TO S + a + b ...` where no operand reads
+    // S again: the right-hand operands of the PLUS chain, in order
+    std::pmr::vector<Expression*> appendOperands;
+    Assignment(std::string_view name, NodePtr<Expression> val, NodePtr<Expression> idx,
+               std::pmr::memory_resource* memory)
+        : varName(name), index(std::move(idx)), value(std::move(val)), appendOperands(memory) {}
 };
 
 struct ForLoop : Statement {
-    std::string varName;
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> body;
-    ForLoop(const std::string& var, std::unique_ptr<Expression> cond)
-        : varName(var), condition(std::move(cond)) {}
+    std::string_view varName;
+    NodePtr<Expression> condition;
+    NodeList<Statement> body;
+    ForLoop(std::string_view var, NodePtr<Expression> cond, std::pmr::memory_resource* memory)
+        : varName(var), condition(std::move(cond)), body(memory) {}
 };
 
 struct WhileLoop : Statement {
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> body;
-    WhileLoop(std::unique_ptr<Expression> cond) : condition(std::move(cond)) {}
+    NodePtr<Expression> condition;
+    NodeList<Statement> body;
+    WhileLoop(NodePtr<Expression> cond, std::pmr::memory_resource* memory)
+        : condition(std::move(cond)), body(memory) {}
 };
 
 struct ElseIfClause {
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> body;
-    ElseIfClause(std::unique_ptr<Expression> cond) : condition(std::move(cond)) {}
+    NodePtr<Expression> condition;
+    NodeList<Statement> body;
+    ElseIfClause(NodePtr<Expression> cond, std::pmr::memory_resource* memory)
+        : condition(std::move(cond)), body(memory) {}
 };
 
 struct IfStatement : Statement {
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<Statement>> thenBranch;
-    std::vector<ElseIfClause> elseIfClauses;
-    std::vector<std::unique_ptr<Statement>> elseBranch;
-    IfStatement(std::unique_ptr<Expression> cond) : condition(std::move(cond)) {}
+    NodePtr<Expression> condition;
+    NodeList<Statement> thenBranch;
+    std::pmr::vector<ElseIfClause> elseIfClauses;
+    NodeList<Statement> elseBranch;
+    IfStatement(NodePtr<Expression> cond, std::pmr::memory_resource* memory)
+        : condition(std::move(cond)), thenBranch(memory), elseIfClauses(memory), elseBranch(memory) {}
 };
 
 struct IncrementStatement : Statement {
-    std::string varName;
+    std::string_view varName;
+    int slot = -1;
     int amount;
-    IncrementStatement(const std::string& name, int amt) : varName(name), amount(amt) {}
+    IncrementStatement(std::string_view name, int amt) : varName(name), amount(amt) {}
 };
 
 struct ReadStatement : Statement {
-    std::string varName;
-    ReadStatement(const std::string& name) : varName(name) {}
+    std::string_view varName;
+    int slot = -1;
+    ReadStatement(std::string_view name) : varName(name) {}
 };
 
+// One entry per distinct variable name, indexed by the slot numbers the
+// Resolver writes into the AST. The type and size come from the first
+// declaration of the name.
+struct VariableSlot {
+    std::string name;
+    std::string type;
+    int arraySize;
+    bool integerOnly = false; // set by the TypeChecker: never holds anything but an integer
+};
+
+// Owns the arena that holds the whole tree; it is declared first so it
+// outlives the statement list that points into it
 struct Program : ASTNode {
-    std::vector<std::unique_ptr<Statement>> statements;
+    std::unique_ptr<Arena> arena;
+    std::vector<std::unique_ptr<Arena>> chunkArenas; // nodes of chunks parsed in parallel
+    NodeList<Statement> statements;
+    std::vector<VariableSlot> slots;
+    explicit Program(std::unique_ptr<Arena> nodes)
+        : arena(std::move(nodes)), statements(arena->resource()) {}
 };
 
+// The keyword a statement starts with, for reports and traces
+const char* statementKeyword(const Statement* stmt);
+
 class Parser {
 private:
-    std::vector<Token> tokens;
-    size_t current;
+    // Tokens are pulled from the lexer as the parser advances, so only the
+    // current token and the one before it exist at any time
+    Lexer& lexer;
+    std::string_view source; // the text the tokens point into
+    Token currentToken;
+    Token previousToken;
+    size_t current; // index of currentToken, for diagnostics
+    Arena* arena = nullptr; // the arena of the Program being built
+    bool reportErrors;
+    int errors = 0;
     
-    Token peek();
-    Token previous();
+    const Token& peek();
+    const Token& previous();
     bool isAtEnd();
     bool check(TokenType type);
     bool match(std::initializer_list<TokenType> types);
-    Token advance();
-    Token consume(TokenType type, const std::string& message);
+    const Token& advance();
+    const Token& consume(TokenType type, const char* message);
+    std::string_view text(const Token& token) const { return token.text(source); }
+    int integer(const Token& token) const;
     void skipNewlines();
     
-    std::unique_ptr<Expression> expression();
-    std::unique_ptr<Expression> logicalOr();
-    std::unique_ptr<Expression> logicalAnd();
-    std::unique_ptr<Expression> equality();
-    std::unique_ptr<Expression> addition();
-    std::unique_ptr<Expression> multiplication();
-    std::unique_ptr<Expression> primary();
+    NodePtr<Expression> expression();
+    NodePtr<Expression> logicalOr();
+    NodePtr<Expression> logicalAnd();
+    NodePtr<Expression> equality();
+    NodePtr<Expression> addition();
+    NodePtr<Expression> multiplication();
+    NodePtr<Expression> primary();
     
-    std::unique_ptr<Statement> statement();
-    std::unique_ptr<Statement> printStatement();
-    std::unique_ptr<Statement> varDeclaration();
-    std::unique_ptr<Statement> assignment();
-    std::unique_ptr<Statement> forLoop();
-    std::unique_ptr<Statement> whileLoop();
-    std::unique_ptr<Statement> ifStatement();
-    std::unique_ptr<Statement> incrementStatement();
-    std::unique_ptr<Statement> readStatement();
+    NodePtr<Statement> statement();
+    NodePtr<Statement> printStatement();
+    NodePtr<Statement> varDeclaration();
+    NodePtr<Statement> assignment();
+    NodePtr<Statement> forLoop();
+    NodePtr<Statement> whileLoop();
+    NodePtr<Statement> ifStatement();
+    NodePtr<Statement> incrementStatement();
+    NodePtr<Statement> readStatement();
     
 public:
-    Parser(std::vector<Token> tokens);
+    // A parser with reportErrors false stays silent and only counts errors
+    explicit Parser(Lexer& lexer, bool reportErrors = true);
     std::unique_ptr<Program> parse();
+    // Parses one piece of a source split at top-level statements. Only the
+    // first piece may open with the !I_LOVE_GOVERNMENT header. Returns
+    // nullptr on any error, including a token no statement can start with,
+    // so the caller can fall back to parse() and its diagnostics.
+    std::unique_ptr<Program> parseChunk(bool first);
+
+    int errorCount() const { return errors; }
 };
\ No newline at end of file
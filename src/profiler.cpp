@@ -0,0 +1,142 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+namespace {
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string frame(const char* kind, int line) {
+    return std::string(kind) + " line " + std::to_string(line);
+}
+
+// Trims indentation and shortens long lines for the report
+std::string_view sourceLine(std::string_view source, const std::vector<size_t>& lineStarts, int line) {
+    if (line < 1 || static_cast<size_t>(line) > lineStarts.size()) {
+        return {};
+    }
+    size_t begin = lineStarts[line - 1];
+    size_t end = source.find('\n', begin);
+    std::string_view text = source.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == '\r' || text.back() == ' ')) {
+        text.remove_suffix(1);
+    }
+    return text.substr(0, 60);
+}
+
+} // namespace
+
+Profiler::Profiler(const Program& program, const std::string& name) {
+    addBlock(program.statements, name);
+    entryFor.reserve(entries.size());
+    for (Entry& entry : entries) {
+        entryFor.emplace(entry.stmt, &entry);
+    }
+}
+
+void Profiler::addBlock(const NodeList<Statement>& block, const std::string& stack) {
+    for (const auto& stmt : block) {
+        std::string own = stack + ";" + frame(statementKeyword(stmt.get()), stmt->line);
+        entries.push_back({stmt.get(), own});
+        if (auto forLoop = dynamic_cast<const ForLoop*>(stmt.get())) {
+            addBlock(forLoop->body, own);
+        } else if (auto whileLoop = dynamic_cast<const WhileLoop*>(stmt.get())) {
+            addBlock(whileLoop->body, own);
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt.get())) {
+            addBlock(ifStmt->thenBranch, own);
+            for (const auto& clause : ifStmt->elseIfClauses) {
+                addBlock(clause.body, own + ";" + frame("ELSE_IF", clause.condition->line));
+            }
+            addBlock(ifStmt->elseBranch, own + ";ELSE");
+        }
+    }
+}
+
+void Profiler::enter(const Statement* stmt) {
+    active.push_back({entryFor.at(stmt), nowNs(), 0});
+}
+
+void Profiler::exit() {
+    Active done = active.back();
+    active.pop_back();
+    uint64_t elapsed = nowNs() - done.start;
+    done.entry->count++;
+    done.entry->totalNs += elapsed;
+    done.entry->selfNs += elapsed - std::min(done.childNs, elapsed);
+    if (!active.empty()) {
+        active.back().childNs += elapsed;
+    }
+}
+
+void Profiler::report(std::ostream& out, std::string_view source, size_t limit) const {
+    struct Line {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t selfNs = 0;
+    };
+    std::map<int, Line> lines;
+    uint64_t executed = 0;
+    uint64_t selfNs = 0;
+    for (const Entry& entry : entries) {
+        if (entry.count == 0) continue;
+        Line& line = lines[entry.stmt->line];
+        line.count += entry.count;
+        line.totalNs += entry.totalNs;
+        line.selfNs += entry.selfNs;
+        executed += entry.count;
+        selfNs += entry.selfNs;
+    }
+
+    std::vector<std::pair<int, Line>> hottest(lines.begin(), lines.end());
+    std::stable_sort(hottest.begin(), hottest.end(), [](const auto& a, const auto& b) {
+        return a.second.selfNs > b.second.selfNs;
+    });
+    if (hottest.size() > limit) {
+        hottest.resize(limit);
+    }
+
+    std::vector<size_t> lineStarts{0};
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i] == '\n') {
+            lineStarts.push_back(i + 1);
+        }
+    }
+
+    char row[128];
+    std::snprintf(row, sizeof(row), "%llu statements executed in %.3f ms\n\n",
+                  static_cast<unsigned long long>(executed), selfNs / 1e6);
+    out << row;
+    out << "    Line        Count     Self ms  Self %    Total ms  Source\n";
+    for (const auto& [number, line] : hottest) {
+        std::snprintf(row, sizeof(row), "%8d %12llu %11.3f %6.1f%% %11.3f  ", number,
+                      static_cast<unsigned long long>(line.count), line.selfNs / 1e6,
+                      selfNs ? 100.0 * line.selfNs / selfNs : 0.0, line.totalNs / 1e6);
+        out << row << sourceLine(source, lineStarts, number) << "\n";
+    }
+    out.flush();
+}
+
+bool Profiler::writeFolded(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    for (const Entry& entry : entries) {
+        if (entry.count > 0) {
+            file << entry.stack << " " << entry.selfNs / 1000 << "\n";
+        }
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
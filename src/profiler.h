@@ -0,0 +1,68 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Execution counts and wall time per statement for `gov profile`. Every
+// statement executed, at every depth, is bracketed with enter() and exit()
+// through ProfileHooks. A statement's self time leaves out the statements
+// nested in it, so the self time of a loop or IF is what its conditions
+// cost.
+class Profiler {
+private:
+    struct Entry {
+        const Statement* stmt;
+        std::string stack; // folded frames from the program down to the statement
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t selfNs = 0;
+    };
+    struct Active {
+        Entry* entry;
+        uint64_t start;
+        uint64_t childNs;
+    };
+
+    std::vector<Entry> entries; // never resized once built, Active points into it
+    std::unordered_map<const Statement*, Entry*> entryFor;
+    std::vector<Active> active;
+
+    void addBlock(const NodeList<Statement>& block, const std::string& stack);
+
+public:
+    // `name` is the root frame of every folded stack, usually the source file
+    Profiler(const Program& program, const std::string& name);
+
+    void enter(const Statement* stmt);
+    void exit();
+
+    // The `limit` lines with the most self time, next to their source text
+    void report(std::ostream& out, std::string_view source, size_t limit = 20) const;
+    // One line per executed statement: its frames and self time in microseconds
+    bool writeFolded(const std::string& path) const;
+};
+
+// Interpreter hooks that feed a Profiler
+class ProfileHooks {
+private:
+    Profiler* profiler;
+    uint64_t executed = 0;
+
+public:
+    explicit ProfileHooks(Profiler& target) : profiler(&target) {}
+
+    void programStarted(const Program&, const std::vector<Value>&) { executed = 0; }
+    void beforeStatement(const Statement* stmt, const std::vector<Value>&) {
+        executed++;
+        profiler->enter(stmt);
+    }
+    void afterStatement(const Statement*, const std::vector<Value>&) { profiler->exit(); }
+    void variableWritten(const std::vector<Value>&, int, const Value*) {}
+    void programFinished(const std::vector<Value>&) {}
+    uint64_t getStatementsExecuted() const { return executed; }
+};
@@ -0,0 +1,157 @@
+#include "resolver.h"
+#include <iostream>
+
+void Resolver::error(const std::string& message, const ASTNode* node) {
+    std::cerr << "Resolve error: " << message << " at line " << node->line
+              << ", column " << node->column << std::endl;
+    hadError = true;
+}
+
+int Resolver::lookup(std::string_view name, const ASTNode* node) {
+    auto it = slots.find(name);
+    if (it != slots.end()) {
+        return it->second;
+    }
+
+    error("Undefined variable '" + std::string(name) + "'", node);
+    return -1;
+}
+
+void Resolver::declare(VarDeclaration* decl) {
+    auto it = slots.find(decl->name);
+    if (it != slots.end()) {
+        // Redeclaring a name reuses its slot; the statement still resets it
+        decl->slot = it->second;
+        return;
+    }
+
+    decl->slot = static_cast<int>(program->slots.size());
+    slots[decl->name] = decl->slot;
+    program->slots.push_back({std::string(decl->name), std::string(decl->type), decl->arraySize});
+}
+
+void Resolver::resolveExpression(Expression* expr) {
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        id->slot = lookup(id->name, id);
+        return;
+    }
+
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        resolveExpression(access->array.get());
+        resolveExpression(access->index.get());
+        return;
+    }
+
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        resolveExpression(binOp->left.get());
+        resolveExpression(binOp->right.get());
+        return;
+    }
+}
+
+static bool readsSlot(Expression* expr, int slot) {
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        return id->slot == slot;
+    }
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        return readsSlot(access->array.get(), slot) || readsSlot(access->index.get(), slot);
+    }
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        return readsSlot(binOp->left.get(), slot) || readsSlot(binOp->right.get(), slot);
+    }
+    return false;
+}
+
+// `SET S TO S + a + b` parses as ((S + a) + b). Walking down the left spine
+// of PLUS nodes to S itself lets the engines evaluate it as S += a; S += b,
+// which is only equivalent when none of the operands reads S.
+void Resolver::findSelfAppend(Assignment* assign) {
+    std::vector<Expression*> operands;
+    Expression* expr = assign->value.get();
+    while (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        if (binOp->op != TokenType::PLUS || readsSlot(binOp->right.get(), assign->slot)) {
+            return;
+        }
+        operands.push_back(binOp->right.get());
+        expr = binOp->left.get();
+    }
+
+    auto id = dynamic_cast<Identifier*>(expr);
+    if (id && id->slot == assign->slot && !operands.empty()) {
+        assign->appendOperands.assign(operands.rbegin(), operands.rend());
+    }
+}
+
+void Resolver::resolveBlock(const NodeList<Statement>& block) {
+    for (auto& stmt : block) {
+        resolveStatement(stmt.get());
+    }
+}
+
+void Resolver::resolveStatement(Statement* stmt) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
+        resolveExpression(print->expr.get());
+        return;
+    }
+
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        declare(decl);
+        return;
+    }
+
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        resolveExpression(assign->value.get());
+        if (assign->index) {
+            resolveExpression(assign->index.get());
+        }
+        assign->slot = lookup(assign->varName, assign);
+        if (!assign->index && assign->slot >= 0) {
+            findSelfAppend(assign);
+        }
+        return;
+    }
+
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        resolveExpression(forLoop->condition.get());
+        resolveBlock(forLoop->body);
+        return;
+    }
+
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        resolveExpression(whileLoop->condition.get());
+        resolveBlock(whileLoop->body);
+        return;
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        resolveExpression(ifStmt->condition.get());
+        resolveBlock(ifStmt->thenBranch);
+        for (auto& elseIfClause : ifStmt->elseIfClauses) {
+            resolveExpression(elseIfClause.condition.get());
+            resolveBlock(elseIfClause.body);
+        }
+        resolveBlock(ifStmt->elseBranch);
+        return;
+    }
+
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        inc->slot = lookup(inc->varName, inc);
+        return;
+    }
+
+    if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
+        read->slot = lookup(read->varName, read);
+        return;
+    }
+}
+
+bool Resolver::resolve(Program* program) {
+    this->program = program;
+    slots.clear();
+    hadError = false;
+    program->slots.clear();
+
+    resolveBlock(program->statements);
+
+    return !hadError;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "parser.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Runs after Parser::parse. Gives every declared variable a dense slot index,
+// writes the slot into each node that names a variable and fills
+// Program::slots. Names used before any declaration are reported here, so
+// execution engines never have to look a variable up by name. It also marks
+// assignments that only append to their own variable.
+class Resolver {
+private:
+    std::unordered_map<std::string_view, int> slots; // names point into the Program's arena
+    Program* program = nullptr;
+    bool hadError = false;
+
+    int lookup(std::string_view name, const ASTNode* node);
+    void declare(VarDeclaration* decl);
+    void error(const std::string& message, const ASTNode* node);
+
+    void resolveExpression(Expression* expr);
+    void findSelfAppend(Assignment* assign);
+    void resolveStatement(Statement* stmt);
+    void resolveBlock(const NodeList<Statement>& block);
+
+public:
+    bool resolve(Program* program);
+};
@@ -0,0 +1,183 @@
+#include "scan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GOV_SCAN_X64 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool isStringStop(char c) {
+    return c == '"' || c == '\n' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+size_t scalarSkipBlanks(const char* data, size_t pos, size_t end) {
+    while (pos < end && isBlank(data[pos])) pos++;
+    return pos;
+}
+
+size_t scalarFindNewline(const char* data, size_t pos, size_t end) {
+    while (pos < end && data[pos] != '\n') pos++;
+    return pos;
+}
+
+size_t scalarFindStringStop(const char* data, size_t pos, size_t end) {
+    while (pos < end && !isStringStop(data[pos])) pos++;
+    return pos;
+}
+
+const Scanners SCALAR_SCANNERS = {"scalar", scalarSkipBlanks, scalarFindNewline, scalarFindStringStop};
+
+#ifdef GOV_SCAN_X64
+
+// SSE2 is part of x86-64, so these need no runtime check. A set bit in a
+// movemask marks a byte the scan stops on.
+
+size_t sse2SkipBlanks(const char* data, size_t pos, size_t end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    // Indentation is short, so check the first byte before loading a block
+    if (pos < end && !isBlank(data[pos])) return pos;
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                     _mm_cmpeq_epi8(block, carriageReturn));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(blank)) & 0xFFFF;
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return scalarSkipBlanks(data, pos, end);
+}
+
+size_t sse2FindNewline(const char* data, size_t pos, size_t end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return scalarFindNewline(data, pos, end);
+}
+
+size_t sse2FindStringStop(const char* data, size_t pos, size_t end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, newline));
+        // The sign bit of each byte flags non-ASCII directly
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(stop) | _mm_movemask_epi8(block));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return scalarFindStringStop(data, pos, end);
+}
+
+const Scanners SSE2_SCANNERS = {"sse2", sse2SkipBlanks, sse2FindNewline, sse2FindStringStop};
+
+// AVX2 variants are compiled for that target only and picked at run time
+
+__attribute__((target("avx2"))) size_t avx2SkipBlanks(const char* data, size_t pos, size_t end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i carriageReturn = _mm256_set1_epi8('\r');
+    if (pos < end && !isBlank(data[pos])) return pos;
+    for (; pos + 32 <= end; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i blank = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+            _mm256_cmpeq_epi8(block, carriageReturn));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return sse2SkipBlanks(data, pos, end);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindNewline(const char* data, size_t pos, size_t end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; pos + 32 <= end; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return sse2FindNewline(data, pos, end);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindStringStop(const char* data, size_t pos, size_t end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; pos + 32 <= end; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, newline));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(stop)) |
+                        static_cast<unsigned>(_mm256_movemask_epi8(block));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+    return sse2FindStringStop(data, pos, end);
+}
+
+const Scanners AVX2_SCANNERS = {"avx2", avx2SkipBlanks, avx2FindNewline, avx2FindStringStop};
+
+#endif
+
+const Scanners& bestScanners() {
+    if (const Scanners* avx2 = scannersFor(ScanLevel::AVX2)) return *avx2;
+    if (const Scanners* sse2 = scannersFor(ScanLevel::SSE2)) return *sse2;
+    return SCALAR_SCANNERS;
+}
+
+} // namespace
+
+const Scanners* scannersFor(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::SCALAR:
+            return &SCALAR_SCANNERS;
+#ifdef GOV_SCAN_X64
+        case ScanLevel::SSE2:
+            return &SSE2_SCANNERS;
+        case ScanLevel::AVX2:
+            return __builtin_cpu_supports("avx2") ? &AVX2_SCANNERS : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const Scanners& scanners() {
+    static const Scanners& chosen = bestScanners();
+    return chosen;
+}
+
+size_t utf8SequenceLength(const unsigned char* data, size_t available) {
+    unsigned char lead = data[0];
+    if (lead < 0x80) return 1;
+
+    size_t length;
+    // Bounds for the second byte rule out overlong forms, UTF-16
+    // surrogates and code points above U+10FFFF
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+
+    if (available < length) return 0;
+    if (data[1] < low || data[1] > high) return 0;
+    for (size_t i = 2; i < length; i++) {
+        if (data[i] < 0x80 || data[i] > 0xBF) return 0;
+    }
+    return length;
+}
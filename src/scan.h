@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+// Byte scanners for the lexer's hot loops. Each one starts at `pos`, looks
+// at data[pos, end) and returns the offset of the first byte it stops on,
+// or `end` when there is none. The vector versions test 16 (SSE2) or 32
+// (AVX2) bytes per step and never read past `end`.
+struct Scanners {
+    const char* name;
+    // First byte that is not ' ', '\t' or '\r'
+    size_t (*skipBlanks)(const char* data, size_t pos, size_t end);
+    // First '\n', i.e. the end of a // comment
+    size_t (*findNewline)(const char* data, size_t pos, size_t end);
+    // First '"', '\n' or non-ASCII byte inside a string literal
+    size_t (*findStringStop)(const char* data, size_t pos, size_t end);
+};
+
+enum class ScanLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// The scanners for `level`, or nullptr when this CPU or build lacks it
+const Scanners* scannersFor(ScanLevel level);
+// The widest scanners the CPU supports, picked on first use
+const Scanners& scanners();
+
+// Length of the well-formed UTF-8 sequence at data[0, available), or 0 when
+// it is malformed (overlong, surrogate, above U+10FFFF or truncated)
+size_t utf8SequenceLength(const unsigned char* data, size_t available);
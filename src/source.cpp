@@ -0,0 +1,87 @@
+#include "source.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SourceFile::~SourceFile() {
+#ifndef _WIN32
+    if (mapping) {
+        munmap(mapping, size);
+    }
+#endif
+}
+
+bool SourceFile::readAll(int fd) {
+    char block[64 * 1024];
+    while (true) {
+#ifdef _WIN32
+        int count = _read(fd, block, sizeof(block));
+#else
+        ssize_t count = read(fd, block, sizeof(block));
+#endif
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        buffer.append(block, static_cast<size_t>(count));
+    }
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+}
+
+bool SourceFile::open(const std::string& filename, bool reportErrors) {
+#ifdef _WIN32
+    int fd = _open(filename.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+#endif
+    if (fd < 0) {
+        if (reportErrors) {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+        }
+        return false;
+    }
+
+    bool loaded = false;
+#ifndef _WIN32
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapping = address;
+            data = static_cast<const char*>(address);
+            size = static_cast<size_t>(info.st_size);
+            // The lexer makes one front-to-back pass
+            madvise(address, size, MADV_SEQUENTIAL);
+            loaded = true;
+        }
+    }
+#endif
+    if (!loaded) {
+        loaded = readAll(fd);
+    }
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    if (!loaded && reportErrors) {
+        std::cerr << "Error: Could not read file " << filename << std::endl;
+    }
+    return loaded;
+}
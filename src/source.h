@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Program text loaded for the front end. Regular files are mapped
+// read-only, so the text is never copied and its pages are shared with the
+// page cache. Anything that cannot be mapped (pipes, empty files, hosts
+// without mmap) is read into an owned buffer instead.
+class SourceFile {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    void* mapping = nullptr;
+    std::string buffer; // fallback storage when the file is not mapped
+
+    bool readAll(int fd);
+
+public:
+    SourceFile() = default;
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    ~SourceFile();
+
+    // Returns false when the file cannot be read, after reporting it on
+    // std::cerr unless reportErrors is false
+    bool open(const std::string& filename, bool reportErrors = true);
+
+    std::string_view text() const { return std::string_view(data, size); }
+    bool isMapped() const { return mapping != nullptr; }
+};
@@ -0,0 +1,217 @@
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<bool> countingAllocations(false);
+std::atomic<uint64_t> allocationCount(0);
+std::atomic<uint64_t> allocatedBytes(0);
+
+void countAllocation(size_t size) {
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+uint64_t countNodes(const Expression* expr) {
+    if (!expr) {
+        return 0;
+    }
+    if (auto access = dynamic_cast<const ArrayAccess*>(expr)) {
+        return 1 + countNodes(access->array.get()) + countNodes(access->index.get());
+    }
+    if (auto binOp = dynamic_cast<const BinaryOp*>(expr)) {
+        return 1 + countNodes(binOp->left.get()) + countNodes(binOp->right.get());
+    }
+    return 1;
+}
+
+uint64_t countNodes(const NodeList<Statement>& block);
+
+uint64_t countNodes(const Statement* stmt) {
+    if (auto print = dynamic_cast<const PrintStatement*>(stmt)) {
+        return 1 + countNodes(print->expr.get());
+    }
+    if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+        return 1 + countNodes(assign->index.get()) + countNodes(assign->value.get());
+    }
+    if (auto forLoop = dynamic_cast<const ForLoop*>(stmt)) {
+        return 1 + countNodes(forLoop->condition.get()) + countNodes(forLoop->body);
+    }
+    if (auto whileLoop = dynamic_cast<const WhileLoop*>(stmt)) {
+        return 1 + countNodes(whileLoop->condition.get()) + countNodes(whileLoop->body);
+    }
+    if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt)) {
+        uint64_t count = 1 + countNodes(ifStmt->condition.get()) + countNodes(ifStmt->thenBranch);
+        for (const auto& clause : ifStmt->elseIfClauses) {
+            count += countNodes(clause.condition.get()) + countNodes(clause.body);
+        }
+        return count + countNodes(ifStmt->elseBranch);
+    }
+    return 1;
+}
+
+uint64_t countNodes(const NodeList<Statement>& block) {
+    uint64_t count = 0;
+    for (const auto& stmt : block) {
+        count += countNodes(stmt.get());
+    }
+    return count;
+}
+
+} // namespace
+
+void setAllocationCounting(bool enabled) {
+    countingAllocations.store(enabled, std::memory_order_relaxed);
+}
+
+AllocationCounts allocationCounts() {
+    return {allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+Stats::Stats(bool enabled) : enabled(enabled), created(std::chrono::steady_clock::now()) {
+    if (enabled) {
+        setAllocationCounting(true);
+    }
+}
+
+void Stats::begin(const std::string& phase) {
+    if (!enabled) return;
+    end();
+    current = phase;
+    heapAtStart = allocationCounts();
+    phaseStart = std::chrono::steady_clock::now();
+}
+
+void Stats::end() {
+    if (!enabled || current.empty()) return;
+    auto now = std::chrono::steady_clock::now();
+    AllocationCounts heap = allocationCounts();
+    phases.push_back({current, std::chrono::duration<double, std::milli>(now - phaseStart).count(),
+                      {heap.allocations - heapAtStart.allocations, heap.bytes - heapAtStart.bytes}});
+    current.clear();
+}
+
+void Stats::setJson(const std::string& name, std::string json) {
+    for (auto& counter : counters) {
+        if (counter.name == name) {
+            counter.json = std::move(json);
+            return;
+        }
+    }
+    counters.push_back({name, std::move(json)});
+}
+
+void Stats::set(const std::string& name, uint64_t value) {
+    if (!enabled) return;
+    setJson(name, std::to_string(value));
+}
+
+void Stats::set(const std::string& name, const std::string& value) {
+    if (!enabled) return;
+    setJson(name, quoteJson(value));
+}
+
+void Stats::setNull(const std::string& name) {
+    if (!enabled) return;
+    setJson(name, "null");
+}
+
+void Stats::write(std::ostream& out) {
+    if (!enabled) return;
+    end();
+    char number[32];
+    out << "{";
+    for (const auto& counter : counters) {
+        out << quoteJson(counter.name) << ":" << counter.json << ",";
+    }
+    out << "\"phases\":[";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const Phase& phase = phases[i];
+        std::snprintf(number, sizeof(number), "%.3f", phase.milliseconds);
+        out << (i ? "," : "") << "{\"name\":" << quoteJson(phase.name) << ",\"ms\":" << number
+            << ",\"allocations\":" << phase.heap.allocations << ",\"bytes\":" << phase.heap.bytes << "}";
+    }
+    AllocationCounts heap = allocationCounts();
+    std::snprintf(number, sizeof(number), "%.3f",
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - created).count());
+    out << "],\"total_ms\":" << number << ",\"allocations\":" << heap.allocations << ",\"bytes\":" << heap.bytes
+        << "}" << std::endl;
+}
+
+std::string quoteJson(std::string_view text) {
+    std::string json = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            json += escape;
+        } else {
+            json += c;
+        }
+    }
+    return json + "\"";
+}
+
+uint64_t countNodes(const Program& program) {
+    return countNodes(program.statements);
+}
+
+// Replaces the global operator new so that --stats can count heap use. The
+// array and nothrow forms call these. The aligned form is what the arenas'
+// upstream resource allocates with.
+void* operator new(size_t size) {
+    countAllocation(size);
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    countAllocation(size);
+    size_t bytes = size ? size : 1;
+#ifdef _WIN32
+    if (void* pointer = _aligned_malloc(bytes, static_cast<size_t>(alignment))) {
+        return pointer;
+    }
+#else
+    void* pointer = nullptr;
+    if (posix_memalign(&pointer, std::max(static_cast<size_t>(alignment), sizeof(void*)), bytes) == 0) {
+        return pointer;
+    }
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "parser.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Heap use seen by the replaced global operator new while counting is on.
+// Counting is off by default and costs one relaxed load per allocation.
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+void setAllocationCounting(bool enabled);
+AllocationCounts allocationCounts();
+
+// Collects what `--stats` reports: wall time and heap use per phase plus
+// named counters, written as one JSON object. Every call is a no-op on a
+// disabled Stats, so callers need not check.
+class Stats {
+private:
+    struct Phase {
+        std::string name;
+        double milliseconds;
+        AllocationCounts heap;
+    };
+    struct Counter {
+        std::string name;
+        std::string json; // number, quoted string or null
+    };
+
+    bool enabled;
+    std::vector<Phase> phases;
+    std::vector<Counter> counters;
+    std::string current; // phase being timed, empty when none
+    std::chrono::steady_clock::time_point phaseStart;
+    AllocationCounts heapAtStart;
+    std::chrono::steady_clock::time_point created;
+
+    void setJson(const std::string& name, std::string json);
+
+public:
+    explicit Stats(bool enabled);
+
+    bool isEnabled() const { return enabled; }
+
+    // Starts timing `phase`, ending the one before it
+    void begin(const std::string& phase);
+    void end();
+
+    void set(const std::string& name, uint64_t value);
+    void set(const std::string& name, const std::string& value);
+    void setNull(const std::string& name);
+
+    // Ends the current phase and writes everything on one line
+    void write(std::ostream& out);
+};
+
+// Number of AST nodes below `program`, statements and expressions alike
+uint64_t countNodes(const Program& program);
+
+// `text` as a JSON string literal
+std::string quoteJson(std::string_view text);
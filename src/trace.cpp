@@ -0,0 +1,346 @@
+#include "trace.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[8] = {'G', 'O', 'V', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t FORMAT_VERSION = 1;
+
+void putU32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putText(std::string& out, std::string_view text) {
+    putU32(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+// Reads the header back; every read is bounds checked, and a failed one
+// leaves the reader failed
+class HeaderReader {
+private:
+    std::ifstream& in;
+    bool ok = true;
+
+public:
+    explicit HeaderReader(std::ifstream& in) : in(in) {}
+
+    bool good() const { return ok && in.good(); }
+
+    uint32_t u32() {
+        uint32_t value = 0;
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+            ok = false;
+        }
+        return value;
+    }
+
+    std::string text() {
+        uint32_t size = u32();
+        if (!good() || size > (1u << 20)) {
+            ok = false;
+            return {};
+        }
+        std::string value(size, '\0');
+        if (!in.read(value.data(), size)) {
+            ok = false;
+        }
+        return value;
+    }
+};
+
+struct StatementInfo {
+    std::string name; // e.g. "SET line 12"
+    int line;
+};
+
+// Microseconds with nanosecond digits, the unit Chrome traces use
+void putTimestamp(std::ostream& out, uint64_t nanoseconds) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%llu.%03u", static_cast<unsigned long long>(nanoseconds / 1000),
+                  static_cast<unsigned>(nanoseconds % 1000));
+    out << number;
+}
+
+// The stored prefix of a text value, cut back so it does not end inside a
+// UTF-8 sequence when the value was longer
+std::string_view storedText(const TraceEvent& event) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(event.text);
+    size_t size = std::min<size_t>(event.length, sizeof(event.text));
+    if (size < event.length) {
+        size_t lead = size;
+        while (lead > 0 && (bytes[lead - 1] & 0xC0) == 0x80) {
+            lead--;
+        }
+        if (lead > 0 && bytes[lead - 1] >= 0xC0) {
+            size_t needed = bytes[lead - 1] >= 0xF0 ? 4 : bytes[lead - 1] >= 0xE0 ? 3 : 2;
+            if (size - (lead - 1) < needed) {
+                size = lead - 1;
+            }
+        }
+    }
+    return std::string_view(event.text, size);
+}
+
+} // namespace
+
+Tracer::Tracer(const Program& program, const std::string& name) : ring(CAPACITY) {
+    header.append(MAGIC, sizeof(MAGIC));
+    putU32(header, FORMAT_VERSION);
+    putU32(header, sizeof(TraceEvent));
+    putText(header, name);
+
+    addBlock(program.statements);
+    putU32(header, static_cast<uint32_t>(ids.size()));
+    std::vector<const Statement*> byId(ids.size());
+    for (const auto& [stmt, id] : ids) {
+        byId[id] = stmt;
+    }
+    for (const Statement* stmt : byId) {
+        putU32(header, static_cast<uint32_t>(stmt->line));
+        putText(header, statementKeyword(stmt));
+    }
+
+    putU32(header, static_cast<uint32_t>(program.slots.size()));
+    for (const auto& slot : program.slots) {
+        putText(header, slot.name);
+    }
+}
+
+Tracer::~Tracer() {
+    if (writer.joinable()) {
+        close();
+    }
+}
+
+void Tracer::addBlock(const NodeList<Statement>& block) {
+    for (const auto& stmt : block) {
+        ids.emplace(stmt.get(), static_cast<uint32_t>(ids.size()));
+        if (auto forLoop = dynamic_cast<const ForLoop*>(stmt.get())) {
+            addBlock(forLoop->body);
+        } else if (auto whileLoop = dynamic_cast<const WhileLoop*>(stmt.get())) {
+            addBlock(whileLoop->body);
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt.get())) {
+            addBlock(ifStmt->thenBranch);
+            for (const auto& clause : ifStmt->elseIfClauses) {
+                addBlock(clause.body);
+            }
+            addBlock(ifStmt->elseBranch);
+        }
+    }
+}
+
+bool Tracer::open(const std::string& path) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file || std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+        return false;
+    }
+    start = std::chrono::steady_clock::now();
+    writer = std::thread([this]() { drain(); });
+    return true;
+}
+
+bool Tracer::close() {
+    finished.store(true, std::memory_order_release);
+    if (writer.joinable()) {
+        writer.join();
+    }
+    bool ok = file && !writeFailed;
+    if (file && std::fclose(file) != 0) {
+        ok = false;
+    }
+    file = nullptr;
+    return ok;
+}
+
+// The writer thread: copies whatever the interpreter has pushed to the
+// file, a contiguous run of the ring at a time, until close() is called
+// and the ring is empty
+void Tracer::drain() {
+    uint64_t position = 0;
+    for (;;) {
+        bool last = finished.load(std::memory_order_acquire);
+        uint64_t pushed = head.load(std::memory_order_acquire);
+        if (position == pushed) {
+            if (last) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        size_t first = static_cast<size_t>(position & (CAPACITY - 1));
+        size_t count = static_cast<size_t>(std::min<uint64_t>(pushed - position, CAPACITY - first));
+        if (!writeFailed && std::fwrite(&ring[first], sizeof(TraceEvent), count, file) != count) {
+            writeFailed = true;
+        }
+        position += count;
+        tail.store(position, std::memory_order_release);
+    }
+}
+
+void Tracer::waitForSpace(uint64_t position) {
+    waits++;
+    while ((pushLimit = tail.load(std::memory_order_acquire) + CAPACITY) == position) {
+        std::this_thread::yield();
+    }
+}
+
+void Tracer::written(const std::vector<Value>& variables, int slot, const Value* index) {
+    const Value* value = &variables[slot];
+    TraceEvent event{};
+    event.index = -1;
+    if (index) {
+        // A write that elementAt would reject stored nothing
+        value = elementAt(*value, *index);
+        if (!value) {
+            return;
+        }
+        event.index = index->asInt();
+    }
+    event.timestamp = now();
+    event.statement = active.back();
+    event.slot = slot;
+    event.kind = TraceEventKind::WRITE;
+    event.valueKind = value->kind();
+    switch (event.valueKind) {
+        case Value::Kind::INTEGER:
+            event.integer = value->asInt();
+            break;
+        case Value::Kind::STRING: {
+            std::string_view text = value->asString();
+            event.length = static_cast<uint16_t>(std::min<size_t>(text.size(), UINT16_MAX));
+            std::memcpy(event.text, text.data(), std::min(text.size(), sizeof(event.text)));
+            break;
+        }
+        case Value::Kind::ARRAY:
+            event.integer = static_cast<int32_t>(value->asArray().size());
+            break;
+    }
+    push(event);
+}
+
+bool exportChromeTrace(const std::string& tracePath, const std::string& jsonPath) {
+    std::ifstream in(tracePath, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Could not open file " << tracePath << std::endl;
+        return false;
+    }
+    char magic[sizeof(MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    HeaderReader reader(in);
+    uint32_t version = reader.u32();
+    uint32_t eventSize = reader.u32();
+    if (!reader.good() || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != FORMAT_VERSION ||
+        eventSize != sizeof(TraceEvent)) {
+        std::cerr << "Error: " << tracePath << " is not a gov trace" << std::endl;
+        return false;
+    }
+    std::string source = reader.text();
+    // Each entry takes at least 4 bytes, so larger counts are damage
+    const uint32_t maximumEntries = 1u << 28;
+    uint32_t statementCount = reader.u32();
+    std::vector<StatementInfo> statements(statementCount < maximumEntries ? statementCount : 0);
+    for (size_t i = 0; reader.good() && i < statements.size(); i++) {
+        statements[i].line = static_cast<int>(reader.u32());
+        statements[i].name = reader.text() + " line " + std::to_string(statements[i].line);
+    }
+    uint32_t slotCount = reader.good() ? reader.u32() : 0;
+    std::vector<std::string> slots(slotCount < maximumEntries ? slotCount : 0);
+    for (size_t i = 0; reader.good() && i < slots.size(); i++) {
+        slots[i] = reader.text();
+    }
+    if (!reader.good() || statementCount >= maximumEntries || slotCount >= maximumEntries) {
+        std::cerr << "Error: " << tracePath << " has a damaged header" << std::endl;
+        return false;
+    }
+
+    std::ofstream out(jsonPath, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Could not write " << jsonPath << std::endl;
+        return false;
+    }
+    out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"source\":" << quoteJson(source) << "},\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":" << quoteJson("gov " + source)
+        << "}}";
+
+    std::vector<TraceEvent> batch(4096);
+    uint64_t damaged = 0;
+    for (;;) {
+        in.read(reinterpret_cast<char*>(batch.data()), batch.size() * sizeof(TraceEvent));
+        size_t bytes = static_cast<size_t>(in.gcount());
+        if (bytes % sizeof(TraceEvent) != 0) {
+            // The run was cut short in the middle of a write
+            std::cerr << "Warning: " << tracePath << " ends in a partial event" << std::endl;
+        }
+        for (size_t i = 0; i < bytes / sizeof(TraceEvent); i++) {
+            const TraceEvent& event = batch[i];
+            bool valid = event.statement < statements.size() && event.kind <= TraceEventKind::WRITE &&
+                         event.valueKind <= Value::Kind::ARRAY &&
+                         (event.kind != TraceEventKind::WRITE ||
+                          (event.slot >= 0 && static_cast<size_t>(event.slot) < slots.size()));
+            if (!valid) {
+                damaged++;
+                continue;
+            }
+            const StatementInfo& statement = statements[event.statement];
+            out << ",\n{";
+            switch (event.kind) {
+                case TraceEventKind::BEGIN:
+                    out << "\"name\":" << quoteJson(statement.name) << ",\"cat\":\"statement\",\"ph\":\"B\",\"ts\":";
+                    putTimestamp(out, event.timestamp);
+                    out << ",\"pid\":1,\"tid\":1,\"args\":{\"line\":" << statement.line << "}";
+                    break;
+                case TraceEventKind::END:
+                    out << "\"ph\":\"E\",\"ts\":";
+                    putTimestamp(out, event.timestamp);
+                    out << ",\"pid\":1,\"tid\":1";
+                    break;
+                case TraceEventKind::WRITE:
+                    if (event.valueKind == Value::Kind::INTEGER && event.index < 0) {
+                        out << "\"name\":" << quoteJson(slots[event.slot]) << ",\"cat\":\"variable\",\"ph\":\"C\",\"ts\":";
+                        putTimestamp(out, event.timestamp);
+                        out << ",\"pid\":1,\"args\":{\"value\":" << event.integer << "}";
+                        break;
+                    }
+                    out << "\"name\":" << quoteJson(slots[event.slot]) << ",\"cat\":\"variable\",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+                    putTimestamp(out, event.timestamp);
+                    out << ",\"pid\":1,\"tid\":1,\"args\":{";
+                    if (event.index >= 0) {
+                        out << "\"index\":" << event.index << ",";
+                    }
+                    if (event.valueKind == Value::Kind::ARRAY) {
+                        out << "\"size\":" << event.integer;
+                    } else if (event.valueKind == Value::Kind::INTEGER) {
+                        out << "\"value\":" << event.integer;
+                    } else {
+                        out << "\"value\":" << quoteJson(storedText(event)) << ",\"length\":" << event.length;
+                    }
+                    out << ",\"statement\":" << quoteJson(statement.name) << "}";
+                    break;
+            }
+            out << "}";
+        }
+        if (bytes < batch.size() * sizeof(TraceEvent)) {
+            break;
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Could not write " << jsonPath << std::endl;
+        return false;
+    }
+    if (damaged > 0) {
+        std::cerr << "Warning: skipped " << damaged << " damaged events" << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "parser.h"
+#include "value.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Binary execution traces for `gov trace`, converted to Chrome trace JSON
+// by `gov trace-export`. A trace file is a header holding the source name,
+// the statement table and the variable names, followed by fixed-size
+// events up to the end of the file, all in the writing machine's byte
+// order.
+
+enum class TraceEventKind : uint8_t { BEGIN, END, WRITE };
+
+// BEGIN and END bracket a statement. WRITE follows each write to a
+// variable and carries the new value: the integer, the size of an array,
+// or the first bytes of a string or array element.
+struct TraceEvent {
+    uint64_t timestamp; // nanoseconds since the trace started
+    uint32_t statement; // index into the statement table
+    int32_t slot;       // WRITE: the variable written
+    int32_t index;      // WRITE: the array element written, -1 for the whole variable
+    TraceEventKind kind;
+    Value::Kind valueKind;
+    uint16_t length;    // full length of a text value, saturated at 65535
+    int32_t integer;
+    char text[20];
+};
+static_assert(sizeof(TraceEvent) == 48, "trace events have a fixed size");
+
+// Records a program's execution. Events go into a lock-free
+// single-producer, single-consumer ring that a writer thread drains to the
+// file in batches, so the interpreter only waits on the disk when the ring
+// is full.
+class Tracer {
+private:
+    static constexpr uint64_t CAPACITY = 1 << 18; // events, a power of two
+
+    std::unordered_map<const Statement*, uint32_t> ids;
+    std::string header;
+    std::vector<uint32_t> active; // statements being executed, innermost last
+    std::chrono::steady_clock::time_point start;
+
+    std::vector<TraceEvent> ring;
+    alignas(64) std::atomic<uint64_t> head{0}; // events pushed, by the interpreter
+    alignas(64) std::atomic<uint64_t> tail{0}; // events written, by the writer thread
+    alignas(64) uint64_t pushLimit = CAPACITY; // head may reach this without reloading tail
+    uint64_t waits = 0;                        // pushes that found the ring full
+    std::atomic<bool> finished{false};
+    std::FILE* file = nullptr;
+    bool writeFailed = false; // set by the writer thread, read after joining it
+    std::thread writer;
+
+    void addBlock(const NodeList<Statement>& block);
+    void drain();
+    void waitForSpace(uint64_t position);
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void push(const TraceEvent& event) {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        if (position == pushLimit) {
+            waitForSpace(position);
+        }
+        ring[position & (CAPACITY - 1)] = event;
+        head.store(position + 1, std::memory_order_release);
+    }
+
+public:
+    // `name` is recorded in the header, usually the source file
+    Tracer(const Program& program, const std::string& name);
+    ~Tracer();
+
+    // Writes the header and starts the writer thread
+    bool open(const std::string& path);
+    // Writes what is left in the ring and closes the file
+    bool close();
+
+    void begin(const Statement* stmt) {
+        uint32_t id = ids.at(stmt);
+        active.push_back(id);
+        TraceEvent event{};
+        event.timestamp = now();
+        event.statement = id;
+        event.kind = TraceEventKind::BEGIN;
+        push(event);
+    }
+
+    void end() {
+        TraceEvent event{};
+        event.timestamp = now();
+        event.statement = active.back();
+        event.kind = TraceEventKind::END;
+        active.pop_back();
+        push(event);
+    }
+
+    void written(const std::vector<Value>& variables, int slot, const Value* index);
+
+    uint64_t eventCount() const { return head.load(std::memory_order_relaxed); }
+    uint64_t fullRingWaits() const { return waits; }
+};
+
+// Interpreter hooks that feed a Tracer
+class TraceHooks {
+private:
+    Tracer* tracer;
+    uint64_t executed = 0;
+
+public:
+    explicit TraceHooks(Tracer& target) : tracer(&target) {}
+
+    void programStarted(const Program&, const std::vector<Value>&) { executed = 0; }
+    void beforeStatement(const Statement* stmt, const std::vector<Value>&) {
+        executed++;
+        tracer->begin(stmt);
+    }
+    void afterStatement(const Statement*, const std::vector<Value>&) { tracer->end(); }
+    void variableWritten(const std::vector<Value>& variables, int slot, const Value* index) {
+        tracer->written(variables, slot, index);
+    }
+    void programFinished(const std::vector<Value>&) {}
+    uint64_t getStatementsExecuted() const { return executed; }
+};
+
+// Converts the trace at `tracePath` to Chrome trace event JSON, which
+// chrome://tracing, Perfetto and speedscope open. Statements become nested
+// slices, integer variables counter tracks and other writes instant events.
+bool exportChromeTrace(const std::string& tracePath, const std::string& jsonPath);
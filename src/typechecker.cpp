@@ -0,0 +1,305 @@
+#include "typechecker.h"
+#include <iostream>
+
+static StaticType declaredType(const std::string& type) {
+    if (type == "INTEGER") return StaticType::INTEGER;
+    if (type == "STRING") return StaticType::STRING;
+    if (type == "ARRAY_OF_STRING") return StaticType::ARRAY;
+    return StaticType::DYNAMIC;
+}
+
+static bool isScalar(StaticType type) {
+    return type == StaticType::INTEGER || type == StaticType::STRING;
+}
+
+static std::string typeName(StaticType type) {
+    switch (type) {
+        case StaticType::INTEGER: return "INTEGER";
+        case StaticType::STRING: return "STRING";
+        case StaticType::ARRAY: return "ARRAY_OF_STRING";
+        default: return "a value of unknown type";
+    }
+}
+
+static std::string operatorName(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::MULTIPLY: return "*";
+        case TokenType::DIVIDE: return "/";
+        case TokenType::LESS_THAN: return "LESS_THAN";
+        default: return "operator";
+    }
+}
+
+void TypeChecker::error(const std::string& message, const ASTNode* node) {
+    if (!reporting) {
+        return;
+    }
+    std::cerr << "Type error: " << message << " at line " << node->line
+              << ", column " << node->column << std::endl;
+    hadError = true;
+}
+
+StaticType TypeChecker::variableType(int slot) const {
+    if (slot < 0 || static_cast<size_t>(slot) >= proven.size()) {
+        return StaticType::DYNAMIC;
+    }
+    return proven[slot];
+}
+
+StaticType TypeChecker::typeOf(Expression* expr) {
+    if (dynamic_cast<IntegerLiteral*>(expr)) {
+        return StaticType::INTEGER;
+    }
+
+    if (dynamic_cast<StringLiteral*>(expr)) {
+        return StaticType::STRING;
+    }
+
+    if (auto id = dynamic_cast<Identifier*>(expr)) {
+        return variableType(id->slot);
+    }
+
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        auto id = dynamic_cast<Identifier*>(access->array.get());
+        if (id && id->slot >= 0 && isScalar(declared[id->slot])) {
+            error("'" + std::string(id->name) + "' is " + typeName(declared[id->slot]) + ", not an array", access);
+        }
+        StaticType index = typeOf(access->index.get());
+        if (index == StaticType::STRING || index == StaticType::ARRAY) {
+            error("Array index must be INTEGER, got " + typeName(index), access);
+        }
+        // Elements are always stored as text, and a missed lookup yields ""
+        return StaticType::STRING;
+    }
+
+    if (auto binOp = dynamic_cast<BinaryOp*>(expr)) {
+        return binaryType(binOp);
+    }
+
+    return StaticType::DYNAMIC;
+}
+
+StaticType TypeChecker::binaryType(BinaryOp* binOp) {
+    StaticType left = typeOf(binOp->left.get());
+    StaticType right = typeOf(binOp->right.get());
+
+    if (left == StaticType::INTEGER && right == StaticType::INTEGER) {
+        binOp->operands = OperandTypes::INT_INT;
+    } else if (left == StaticType::STRING && right == StaticType::STRING) {
+        binOp->operands = OperandTypes::STRING_STRING;
+    } else if ((left == StaticType::INTEGER && right == StaticType::STRING) ||
+               (left == StaticType::STRING && right == StaticType::INTEGER)) {
+        binOp->operands = OperandTypes::MIXED;
+    } else {
+        binOp->operands = OperandTypes::GENERIC;
+    }
+
+    switch (binOp->op) {
+        case TokenType::PLUS: {
+            bool hasString = left == StaticType::STRING || right == StaticType::STRING;
+            bool hasArray = left == StaticType::ARRAY || right == StaticType::ARRAY;
+            if (hasArray && !hasString) {
+                error("Operator '+' can only join an array with a STRING", binOp);
+            }
+            if (hasString) return StaticType::STRING;
+            if (left == StaticType::INTEGER && right == StaticType::INTEGER) return StaticType::INTEGER;
+            return hasArray ? StaticType::INTEGER : StaticType::DYNAMIC;
+        }
+
+        case TokenType::MINUS:
+        case TokenType::MULTIPLY:
+        case TokenType::DIVIDE:
+        case TokenType::LESS_THAN:
+            for (StaticType operand : {left, right}) {
+                if (operand == StaticType::STRING || operand == StaticType::ARRAY) {
+                    error("Operator '" + operatorName(binOp->op) + "' expects INTEGER operands, got " +
+                          typeName(operand), binOp);
+                    break;
+                }
+            }
+            return StaticType::INTEGER;
+
+        default:
+            // EQUALS, NOT_EQUALS, AND and OR accept anything and yield 0 or 1
+            return StaticType::INTEGER;
+    }
+}
+
+StaticType TypeChecker::storedType(Statement* store) {
+    if (auto assign = dynamic_cast<Assignment*>(store)) {
+        return typeOf(assign->value.get());
+    }
+    // READ stores an integer when the input parses as one, text otherwise
+    return StaticType::DYNAMIC;
+}
+
+void TypeChecker::inferVariableTypes() {
+    proven = declared;
+
+    // A variable loses its declared type as soon as one store may put
+    // something else in it; repeat until no more variables change
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Statement* store : stores) {
+            int slot = -1;
+            if (auto assign = dynamic_cast<Assignment*>(store)) {
+                slot = assign->slot;
+            } else if (auto read = dynamic_cast<ReadStatement*>(store)) {
+                slot = read->slot;
+            }
+            if (slot < 0 || !isScalar(proven[slot])) {
+                continue;
+            }
+            // Stores the checker rejects (STRING or an array into INTEGER)
+            // never run, so they do not widen the type
+            StaticType stored = storedType(store);
+            if (stored == StaticType::DYNAMIC ||
+                (proven[slot] == StaticType::STRING && stored == StaticType::INTEGER)) {
+                proven[slot] = StaticType::DYNAMIC;
+                changed = true;
+            }
+        }
+    }
+}
+
+void TypeChecker::checkDeclaration(VarDeclaration* decl) {
+    if (decl->type.empty()) {
+        error("Variable '" + std::string(decl->name) + "' is declared without a valid type", decl);
+        return;
+    }
+    if (decl->slot < 0) {
+        return;
+    }
+
+    // All declarations of a name share one slot, so they must agree
+    const VariableSlot& first = program->slots[decl->slot];
+    if (first.type != decl->type || first.arraySize != decl->arraySize) {
+        error("Variable '" + std::string(decl->name) + "' redeclared with a different type", decl);
+    }
+}
+
+void TypeChecker::checkBlock(const NodeList<Statement>& block) {
+    for (auto& stmt : block) {
+        checkStatement(stmt.get());
+    }
+}
+
+void TypeChecker::checkStatement(Statement* stmt) {
+    if (auto print = dynamic_cast<PrintStatement*>(stmt)) {
+        typeOf(print->expr.get());
+        return;
+    }
+
+    if (auto decl = dynamic_cast<VarDeclaration*>(stmt)) {
+        checkDeclaration(decl);
+        return;
+    }
+
+    if (auto assign = dynamic_cast<Assignment*>(stmt)) {
+        StaticType value = typeOf(assign->value.get());
+        if (assign->slot < 0) {
+            return;
+        }
+        StaticType target = declared[assign->slot];
+
+        if (assign->index) {
+            if (isScalar(target)) {
+                error("'" + std::string(assign->varName) + "' is " + typeName(target) + ", not an array", assign);
+            }
+            StaticType index = typeOf(assign->index.get());
+            if (index == StaticType::STRING || index == StaticType::ARRAY) {
+                error("Array index must be INTEGER, got " + typeName(index), assign);
+            }
+            if (value == StaticType::ARRAY) {
+                error("Cannot store an array in an element of '" + std::string(assign->varName) + "'", assign);
+            }
+            return;
+        }
+
+        if (!reporting) {
+            stores.push_back(assign);
+        }
+        if (target == StaticType::ARRAY) {
+            error("Cannot assign to array '" + std::string(assign->varName) + "' without an index", assign);
+        } else if (value == StaticType::ARRAY ||
+                   (target == StaticType::INTEGER && value == StaticType::STRING)) {
+            error("Cannot assign " + typeName(value) + " to " + typeName(target) +
+                  " variable '" + std::string(assign->varName) + "'", assign);
+        }
+        return;
+    }
+
+    if (auto forLoop = dynamic_cast<ForLoop*>(stmt)) {
+        typeOf(forLoop->condition.get());
+        checkBlock(forLoop->body);
+        return;
+    }
+
+    if (auto whileLoop = dynamic_cast<WhileLoop*>(stmt)) {
+        typeOf(whileLoop->condition.get());
+        checkBlock(whileLoop->body);
+        return;
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        typeOf(ifStmt->condition.get());
+        checkBlock(ifStmt->thenBranch);
+        for (auto& elseIfClause : ifStmt->elseIfClauses) {
+            typeOf(elseIfClause.condition.get());
+            checkBlock(elseIfClause.body);
+        }
+        checkBlock(ifStmt->elseBranch);
+        return;
+    }
+
+    if (auto inc = dynamic_cast<IncrementStatement*>(stmt)) {
+        if (inc->slot >= 0 && (declared[inc->slot] == StaticType::STRING ||
+                               declared[inc->slot] == StaticType::ARRAY)) {
+            error("INCREMENT needs an INTEGER variable, '" + std::string(inc->varName) + "' is " +
+                  typeName(declared[inc->slot]), inc);
+        }
+        return;
+    }
+
+    if (auto read = dynamic_cast<ReadStatement*>(stmt)) {
+        if (read->slot < 0) {
+            return;
+        }
+        if (!reporting) {
+            stores.push_back(read);
+        }
+        if (declared[read->slot] == StaticType::ARRAY) {
+            error("Cannot READ into array '" + std::string(read->varName) + "'", read);
+        }
+        return;
+    }
+}
+
+bool TypeChecker::check(Program* program) {
+    this->program = program;
+    hadError = false;
+    stores.clear();
+    declared.clear();
+    for (const auto& slot : program->slots) {
+        declared.push_back(declaredType(slot.type));
+    }
+    proven = declared;
+
+    // First pass only collects stores; the second one reports errors and
+    // tags operators using the inferred variable types
+    reporting = false;
+    checkBlock(program->statements);
+    inferVariableTypes();
+
+    reporting = true;
+    checkBlock(program->statements);
+
+    for (size_t i = 0; i < proven.size(); ++i) {
+        program->slots[i].integerOnly = proven[i] == StaticType::INTEGER;
+    }
+
+    return !hadError;
+}
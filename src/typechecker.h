@@ -0,0 +1,37 @@
+#pragma once
+#include "parser.h"
+#include <string>
+#include <vector>
+
+enum class StaticType { INTEGER, STRING, ARRAY, DYNAMIC };
+
+// Runs after the Resolver. Every variable has the type it was declared with,
+// but a variable only keeps that type at runtime if everything stored into
+// it has it too: READ keeps numeric input as an integer and SET accepts an
+// INTEGER for a STRING variable, so such targets are typed DYNAMIC. With
+// those types known, the checker reports operations the language rejects
+// and tags each BinaryOp with the operand types the engines can rely on.
+class TypeChecker {
+private:
+    std::vector<StaticType> declared;
+    std::vector<StaticType> proven; // declared type, or DYNAMIC
+    std::vector<Statement*> stores; // SET and READ statements, for inference
+    Program* program = nullptr;
+    bool reporting = false;
+    bool hadError = false;
+
+    void error(const std::string& message, const ASTNode* node);
+
+    StaticType variableType(int slot) const;
+    StaticType typeOf(Expression* expr);
+    StaticType binaryType(BinaryOp* binOp);
+    StaticType storedType(Statement* store);
+    void inferVariableTypes();
+
+    void checkDeclaration(VarDeclaration* decl);
+    void checkStatement(Statement* stmt);
+    void checkBlock(const NodeList<Statement>& block);
+
+public:
+    bool check(Program* program);
+};
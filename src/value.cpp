@@ -0,0 +1,5 @@
+#include "value.h"
+
+void destroyArray(ValueObject* object) {
+    delete static_cast<ArrayObject*>(object);
+}
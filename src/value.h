@@ -0,0 +1,400 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+struct ValueObject;
+struct StringObject;
+struct ArrayObject;
+
+// Runtime value: one tagged 64-bit word. Integers are stored inline (low bit
+// set, payload in the upper half). Strings and arrays live in reference
+// counted heap objects, so copying a Value never copies characters; moving
+// one steals the reference. Shared objects are cloned only when they are
+// about to be mutated.
+class Value {
+public:
+    enum class Kind : uint8_t { INTEGER, STRING, ARRAY };
+
+    Value() : bits(tagInt(0)) {}
+    Value(int i) : bits(tagInt(i)) {}
+    Value(std::string_view s);
+    Value(const std::string& s) : Value(std::string_view(s)) {}
+    Value(const char* s) : Value(std::string_view(s)) {}
+    Value(const Value& other) : bits(other.bits) { retain(); }
+    Value(Value&& other) noexcept : bits(other.bits) { other.bits = tagInt(0); }
+    ~Value() { release(); }
+
+    Value& operator=(const Value& other) {
+        other.retain();
+        release();
+        bits = other.bits;
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            bits = other.bits;
+            other.bits = tagInt(0);
+        }
+        return *this;
+    }
+
+    // Array of `size` elements that all share `fill`
+    static Value array(size_t size, const Value& fill);
+
+    Kind kind() const;
+    bool isInt() const { return (bits & 1) != 0; }
+    bool isString() const { return kind() == Kind::STRING; }
+    bool isArray() const { return kind() == Kind::ARRAY; }
+
+    int asInt() const { return static_cast<int32_t>(static_cast<uint32_t>(bits >> 32)); }
+    std::string_view asString() const;
+    const std::vector<Value>& asArray() const;
+
+    // Writable access; clones the array first if another Value shares it
+    std::vector<Value>& mutableArray();
+
+    // Appends to a string value. An unshared string grows in place with
+    // doubling capacity, so repeated appends are amortized O(1).
+    void appendText(std::string_view text);
+
+private:
+    uint64_t bits;
+
+    explicit Value(ValueObject* object) : bits(reinterpret_cast<uintptr_t>(object)) {}
+
+    static uint64_t tagInt(int i) { return (static_cast<uint64_t>(static_cast<uint32_t>(i)) << 32) | 1; }
+    ValueObject* object() const { return reinterpret_cast<ValueObject*>(static_cast<uintptr_t>(bits)); }
+    void retain() const;
+    void release();
+};
+
+struct ValueObject {
+    uint32_t refCount;
+    Value::Kind kind;
+};
+
+// Header of a string allocation; the characters follow it in the same block.
+// Lengths are 32-bit to keep the header small, so strings stop at MAX_LENGTH.
+struct StringObject : ValueObject {
+    static constexpr size_t MAX_LENGTH = UINT32_MAX;
+
+    uint32_t length;
+    uint32_t capacity;
+
+    char* chars() { return reinterpret_cast<char*>(this + 1); }
+    const char* chars() const { return reinterpret_cast<const char*>(this + 1); }
+
+    static StringObject* create(std::string_view text, size_t capacity) {
+        if (text.size() > MAX_LENGTH || capacity > MAX_LENGTH) {
+            throw std::length_error("string longer than 4 GiB");
+        }
+        void* memory = ::operator new(sizeof(StringObject) + capacity);
+        auto object = new (memory) StringObject{{1, Value::Kind::STRING},
+                                                static_cast<uint32_t>(text.size()),
+                                                static_cast<uint32_t>(capacity)};
+        std::memcpy(object->chars(), text.data(), text.size());
+        return object;
+    }
+};
+
+struct ArrayObject : ValueObject {
+    std::vector<Value> elements; // always strings
+};
+
+// Deletes an ArrayObject. It lives in value.cpp so release() does not
+// inline the vector destructor where the compiler cannot tell arrays from
+// the smaller string blocks.
+void destroyArray(ValueObject* object);
+
+inline Value::Value(std::string_view s) : Value(StringObject::create(s, s.size())) {}
+
+inline Value Value::array(size_t size, const Value& fill) {
+    return Value(new ArrayObject{{1, Kind::ARRAY}, std::vector<Value>(size, fill)});
+}
+
+inline Value::Kind Value::kind() const {
+    return isInt() ? Kind::INTEGER : object()->kind;
+}
+
+inline std::string_view Value::asString() const {
+    auto string = static_cast<const StringObject*>(object());
+    return std::string_view(string->chars(), string->length);
+}
+
+inline const std::vector<Value>& Value::asArray() const {
+    return static_cast<const ArrayObject*>(object())->elements;
+}
+
+inline std::vector<Value>& Value::mutableArray() {
+    if (object()->refCount > 1) {
+        *this = Value(new ArrayObject{{1, Kind::ARRAY}, asArray()});
+    }
+    return static_cast<ArrayObject*>(object())->elements;
+}
+
+inline void Value::appendText(std::string_view text) {
+    auto string = static_cast<StringObject*>(object());
+    size_t length = string->length + text.size();
+    if (string->refCount == 1 && length <= string->capacity) {
+        std::memcpy(string->chars() + string->length, text.data(), text.size());
+        string->length = static_cast<uint32_t>(length);
+        return;
+    }
+
+    // `text` may point into the old block, so copy it before releasing it
+    size_t capacity = std::max<size_t>(length, std::min(size_t(string->capacity) * 2, StringObject::MAX_LENGTH));
+    auto grown = StringObject::create(asString(), capacity);
+    std::memcpy(grown->chars() + string->length, text.data(), text.size());
+    grown->length = static_cast<uint32_t>(length);
+    *this = Value(grown);
+}
+
+inline void Value::retain() const {
+    if (!isInt()) {
+        object()->refCount++;
+    }
+}
+
+inline void Value::release() {
+    if (isInt() || --object()->refCount > 0) {
+        return;
+    }
+    if (object()->kind == Kind::STRING) {
+        ::operator delete(object());
+    } else {
+        destroyArray(object());
+    }
+}
+
+// Runtime semantics shared by every execution engine. The tree-walking
+// interpreter and the bytecode VM both call into these helpers so that a
+// program prints the same thing no matter how it is executed.
+
+inline void appendValue(std::string& out, const Value& val) {
+    switch (val.kind()) {
+        case Value::Kind::INTEGER: {
+            char buffer[16];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), val.asInt());
+            out.append(buffer, result.ptr);
+            break;
+        }
+        case Value::Kind::STRING:
+            out += val.asString();
+            break;
+        case Value::Kind::ARRAY: {
+            auto& arr = val.asArray();
+            out += "[";
+            for (size_t i = 0; i < arr.size(); ++i) {
+                if (i > 0) out += ", ";
+                out += arr[i].asString();
+            }
+            out += "]";
+            break;
+        }
+    }
+}
+
+inline std::string valueToString(const Value& val) {
+    if (val.isString()) {
+        return std::string(val.asString());
+    }
+    std::string out;
+    appendValue(out, val);
+    return out;
+}
+
+// Same text as valueToString, but strings are shared instead of copied
+inline Value toStringValue(const Value& val) {
+    if (val.isString()) {
+        return val;
+    }
+    return valueToString(val);
+}
+
+// Element `index` of an array value, or nullptr when `array` is not an array
+// or the index is not an in-range integer
+inline const Value* elementAt(const Value& array, const Value& index) {
+    if (!array.isArray() || !index.isInt()) {
+        return nullptr;
+    }
+    auto& arr = array.asArray();
+    int idx = index.asInt();
+    if (idx >= 0 && static_cast<size_t>(idx) < arr.size()) {
+        return &arr[idx];
+    }
+    return nullptr;
+}
+
+// Array element assignment: stores the text of `value`, ignoring writes that
+// elementAt would reject
+inline void storeElement(Value& array, const Value& index, const Value& value) {
+    if (elementAt(array, index)) {
+        array.mutableArray()[index.asInt()] = toStringValue(value);
+    }
+}
+
+inline bool isTruthy(const Value& val) {
+    switch (val.kind()) {
+        case Value::Kind::INTEGER: return val.asInt() != 0;
+        case Value::Kind::STRING: return !val.asString().empty();
+        default: return false;
+    }
+}
+
+// Initial value of a freshly declared variable of the given type
+inline Value defaultValue(std::string_view type, int arraySize) {
+    if (type == "STRING") {
+        return std::string("");
+    } else if (type == "ARRAY_OF_STRING") {
+        return Value::array(arraySize, Value(" "));
+    }
+    return 0;
+}
+
+// Converts a line typed by the user: numbers become integers, everything
+// else is kept as a string. Accepts what std::stoi accepts (leading
+// whitespace, an optional sign, trailing garbage ignored) but reports
+// failure through from_chars instead of an exception.
+inline Value valueFromInput(std::string_view input) {
+    const char* first = input.data();
+    const char* last = first + input.size();
+    while (first != last && (*first == ' ' || (*first >= '\t' && *first <= '\r'))) {
+        ++first;
+    }
+    if (first != last && *first == '+') {
+        ++first;
+        if (first == last || *first < '0' || *first > '9') {
+            return input;
+        }
+    }
+
+    int number;
+    if (std::from_chars(first, last, number).ec == std::errc()) {
+        return number;
+    }
+    return input;
+}
+
+inline Value addValues(const Value& left, const Value& right) {
+    if (left.isString() || right.isString()) {
+        std::string result;
+        result.reserve((left.isString() ? left.asString().size() : 0) +
+                       (right.isString() ? right.asString().size() : 0) + 11);
+        appendValue(result, left);
+        appendValue(result, right);
+        return result;
+    } else if (left.isInt() && right.isInt()) {
+        return left.asInt() + right.asInt();
+    }
+    return 0;
+}
+
+// target = target + right, appending in place when target is a string
+inline void appendValues(Value& target, const Value& right) {
+    if (target.isInt() && right.isInt()) {
+        target = target.asInt() + right.asInt();
+        return;
+    }
+    if (!target.isString()) {
+        target = addValues(target, right);
+        return;
+    }
+
+    switch (right.kind()) {
+        case Value::Kind::INTEGER: {
+            char buffer[16];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), right.asInt());
+            target.appendText(std::string_view(buffer, result.ptr - buffer));
+            break;
+        }
+        case Value::Kind::STRING:
+            target.appendText(right.asString());
+            break;
+        case Value::Kind::ARRAY:
+            target.appendText(valueToString(right));
+            break;
+    }
+}
+
+inline Value subtractValues(const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        return left.asInt() - right.asInt();
+    }
+    return 0;
+}
+
+inline Value multiplyValues(const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        return left.asInt() * right.asInt();
+    }
+    return 0;
+}
+
+inline Value divideValues(const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        int rightVal = right.asInt();
+        if (rightVal != 0) {
+            return left.asInt() / rightVal;
+        }
+    }
+    return 0;
+}
+
+// Compares the decimal text of `number` with `text` without allocating
+inline bool intMatchesText(int number, std::string_view text) {
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    return text == std::string_view(buffer, result.ptr - buffer);
+}
+
+// Equality compares the printed form, with direct paths for operands that
+// are integers or strings, so only arrays are ever converted to text.
+inline bool sameText(const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        return left.asInt() == right.asInt();
+    }
+    if (left.isString() && right.isString()) {
+        return left.asString() == right.asString();
+    }
+    if (left.isInt() && right.isString()) {
+        return intMatchesText(left.asInt(), right.asString());
+    }
+    if (left.isString() && right.isInt()) {
+        return intMatchesText(right.asInt(), left.asString());
+    }
+    return valueToString(left) == valueToString(right);
+}
+
+inline Value equalValues(const Value& left, const Value& right) {
+    return sameText(left, right) ? 1 : 0;
+}
+
+inline Value notEqualValues(const Value& left, const Value& right) {
+    return sameText(left, right) ? 0 : 1;
+}
+
+inline Value lessThanValues(const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        return (left.asInt() < right.asInt()) ? 1 : 0;
+    }
+    return 0;
+}
+
+inline Value andValues(const Value& left, const Value& right) {
+    return (isTruthy(left) && isTruthy(right)) ? 1 : 0;
+}
+
+inline Value orValues(const Value& left, const Value& right) {
+    return (isTruthy(left) || isTruthy(right)) ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+#include "vm.h"
+#include "output.h"
+#include "input.h"
+#include <iostream>
+
+Value VM::pop() {
+    Value value = std::move(stack.back());
+    stack.pop_back();
+    return value;
+}
+
+void VM::run(const Chunk& chunk) {
+    globals.clear();
+    for (const auto& slot : chunk.globals) {
+        globals.push_back(defaultValue(slot.type, slot.arraySize));
+    }
+    stack.clear();
+    stack.reserve(64);
+
+    const Instruction* ip = chunk.code.data();
+
+    while (true) {
+        const Instruction& instr = *ip++;
+
+        switch (instr.op) {
+            case OpCode::CONSTANT:
+                stack.push_back(chunk.constants[instr.b]);
+                break;
+
+            case OpCode::LOAD_GLOBAL:
+                stack.push_back(globals[instr.a]);
+                break;
+
+            case OpCode::STORE_GLOBAL:
+                globals[instr.a] = pop();
+                break;
+
+            case OpCode::LOAD_ELEMENT: {
+                Value& index = stack.back();
+                const Value* element = elementAt(globals[instr.a], index);
+                index = element ? *element : Value("");
+                break;
+            }
+
+            case OpCode::STORE_ELEMENT: {
+                Value index = pop();
+                Value value = pop();
+                storeElement(globals[instr.a], index, value);
+                break;
+            }
+
+            case OpCode::INCREMENT:
+                if (globals[instr.a].isInt()) {
+                    globals[instr.a] = globals[instr.a].asInt() + instr.b;
+                }
+                break;
+
+            case OpCode::APPEND:
+                appendValues(globals[instr.a], stack.back());
+                stack.pop_back();
+                break;
+
+            case OpCode::READ: {
+                std::string_view input;
+                standardOutput().flushForInput();
+                standardInput().readLine(input);
+                globals[instr.a] = valueFromInput(input);
+                break;
+            }
+
+            case OpCode::PRINT:
+                standardOutput().printLine(stack.back());
+                stack.pop_back();
+                break;
+
+            // Arithmetic and comparisons take an integer fast path before
+            // falling back to the shared value semantics.
+            case OpCode::ADD: {
+                Value right = pop();
+                Value& left = stack.back();
+                if (left.isInt() && right.isInt()) {
+                    left = left.asInt() + right.asInt();
+                } else {
+                    left = addValues(left, right);
+                }
+                break;
+            }
+
+            case OpCode::SUBTRACT: {
+                Value right = pop();
+                Value& left = stack.back();
+                if (left.isInt() && right.isInt()) {
+                    left = left.asInt() - right.asInt();
+                } else {
+                    left = subtractValues(left, right);
+                }
+                break;
+            }
+
+            case OpCode::MULTIPLY: {
+                Value right = pop();
+                Value& left = stack.back();
+                if (left.isInt() && right.isInt()) {
+                    left = left.asInt() * right.asInt();
+                } else {
+                    left = multiplyValues(left, right);
+                }
+                break;
+            }
+
+            case OpCode::DIVIDE: {
+                Value right = pop();
+                Value& left = stack.back();
+                left = divideValues(left, right);
+                break;
+            }
+
+            case OpCode::EQUALS: {
+                Value right = pop();
+                Value& left = stack.back();
+                if (left.isInt() && right.isInt()) {
+                    left = (left.asInt() == right.asInt()) ? 1 : 0;
+                } else {
+                    left = equalValues(left, right);
+                }
+                break;
+            }
+
+            case OpCode::NOT_EQUALS: {
+                Value right = pop();
+                Value& left = stack.back();
+                if (left.isInt() && right.isInt()) {
+                    left = (left.asInt() != right.asInt()) ? 1 : 0;
+                } else {
+                    left = notEqualValues(left, right);
+                }
+                break;
+            }
+
+            case OpCode::LESS_THAN: {
+                Value right = pop();
+                Value& left = stack.back();
+                left = lessThanValues(left, right);
+                break;
+            }
+
+            case OpCode::AND: {
+                Value right = pop();
+                Value& left = stack.back();
+                left = andValues(left, right);
+                break;
+            }
+
+            case OpCode::OR: {
+                Value right = pop();
+                Value& left = stack.back();
+                left = orValues(left, right);
+                break;
+            }
+
+            // Operands proven to be integers: no tag checks needed
+            case OpCode::ADD_INT: {
+                int right = pop().asInt();
+                stack.back() = stack.back().asInt() + right;
+                break;
+            }
+
+            case OpCode::SUBTRACT_INT: {
+                int right = pop().asInt();
+                stack.back() = stack.back().asInt() - right;
+                break;
+            }
+
+            case OpCode::MULTIPLY_INT: {
+                int right = pop().asInt();
+                stack.back() = stack.back().asInt() * right;
+                break;
+            }
+
+            case OpCode::DIVIDE_INT: {
+                int right = pop().asInt();
+                stack.back() = right != 0 ? stack.back().asInt() / right : 0;
+                break;
+            }
+
+            case OpCode::EQUALS_INT: {
+                int right = pop().asInt();
+                stack.back() = (stack.back().asInt() == right) ? 1 : 0;
+                break;
+            }
+
+            case OpCode::NOT_EQUALS_INT: {
+                int right = pop().asInt();
+                stack.back() = (stack.back().asInt() != right) ? 1 : 0;
+                break;
+            }
+
+            case OpCode::LESS_THAN_INT: {
+                int right = pop().asInt();
+                stack.back() = (stack.back().asInt() < right) ? 1 : 0;
+                break;
+            }
+
+            case OpCode::JUMP:
+                ip += instr.b;
+                break;
+
+            case OpCode::JUMP_IF_FALSE:
+                if (!isTruthy(pop())) {
+                    ip += instr.b;
+                }
+                break;
+
+            case OpCode::HALT:
+                return;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "compiler.h"
+#include <vector>
+
+// Stack machine that executes a compiled Chunk. Globals live in a flat
+// vector indexed by the slots the Resolver assigned to each name.
+class VM {
+private:
+    std::vector<Value> globals;
+    std::vector<Value> stack;
+
+    Value pop();
+
+public:
+    void run(const Chunk& chunk);
+};